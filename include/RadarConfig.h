@@ -0,0 +1,88 @@
+#pragma once
+
+#include "OccupancyGrid.h"
+#include "RangeFilter.h"
+#include "ScanController.h"
+#include "ServoMotion.h"
+
+// ===== Radar configuration =====
+// Scan and detection settings, shared by the ESP32 build (src/main.cpp)
+// and the host build (src/native/) so both run the same scan.
+const float MIN_DETECTION_LIMIT = 30.0;
+const float MAX_DETECTION_LIMIT = 400.0;  // HC-SR04 max range ~400cm
+const int SCAN_STEP = 5;
+const int SCAN_DELAY = 200;                 // Upper bound on the servo settle wait
+const int DETECT_HOLD = 100;               // Extra dwell while an object is in range
+const unsigned long PING_GUARD_US = 50;    // Gap between pings of one reading
+
+// ===== Reading filter =====
+// Two pings that agree end a reading; disagreement pulls in up to five.
+const RangeFilterConfig RANGE_FILTER = {
+  FILTER_MEDIAN,  // mode
+  2,              // minPings
+  5,              // maxPings
+  2.0,            // toleranceCm
+  0.02,           // toleranceFraction
+  0.2,            // trimFraction
+  3.0,            // hampelK
+};
+
+// ===== Range gating =====
+// Optionally stop listening just beyond the detection limit instead of
+// waiting out the sensor's full ~400cm. Readings come back sooner, but
+// farther objects read as out of range, so /scan and the grid lose what
+// lies past the limit. Off by default; build with -DRANGE_GATING=1 to
+// trade the far view for scan speed.
+#ifndef RANGE_GATING
+#define RANGE_GATING 0
+#endif
+const float RANGE_GATE_MARGIN = 20.0;      // cm listened past detectionLimit
+const uint32_t ECHO_RESPONSE_US = 500;     // Trigger to echo-line rise
+
+// How far a reading at this detection limit could have seen
+inline float listenRangeCm(float limitCm) {
+  float gateCm = limitCm + RANGE_GATE_MARGIN;
+  return RANGE_GATING && gateCm < MAX_DETECTION_LIMIT ? gateCm : MAX_DETECTION_LIMIT;
+}
+
+// ===== Servo motion =====
+// SG90-class servo under the sensor's load. Small steps settle in a few
+// tens of ms; the 0/180 reversals get extra time for backlash.
+const ServoMotionConfig SERVO_MOTION = {
+  2.0,         // msPerDegree
+  25,          // settleMarginMs
+  60,          // reversalExtraMs
+  20,          // minWaitMs
+  SCAN_DELAY,  // maxWaitMs
+};
+
+// ===== Occupancy grid =====
+// 10cm cells out to MAX_DETECTION_LIMIT. Each angle is seen about every
+// 2.5s; a solid object settles near +90 and a clear path near -40, and
+// cells no longer looked at fade to unknown within about a minute.
+const int GRID_CELL_CM = 10;
+const int GRID_RANGE_BINS = 40;
+const OccupancyConfig OCCUPANCY = {
+  14,    // hit: p ~0.7 per echo
+  -6,    // miss: p ~0.4 per ping through
+  1000,  // decayPeriodMs
+  4,     // decayShift: 1/16 per period
+};
+
+// ===== Update-rate SLA =====
+// A reading normally arrives every ~70ms and a sweep takes ~2.5s; holding
+// on a detection stretches both. Periods past these limits are counted as
+// violations (see lib/PeriodMonitor).
+const uint32_t READING_PERIOD_LIMIT_MS = 250;
+const uint32_t SWEEP_PERIOD_LIMIT_MS = 3500;
+
+// ===== Scan =====
+const ScanConfig SCAN = {
+  SCAN_STEP,            // stepDeg
+  DETECT_HOLD,          // detectHoldMs
+  PING_GUARD_US,        // pingGuardUs
+  RANGE_GATING != 0,    // rangeGating
+  RANGE_GATE_MARGIN,    // gateMarginCm
+  ECHO_RESPONSE_US,     // echoResponseUs
+  MAX_DETECTION_LIMIT,  // maxRangeCm
+};
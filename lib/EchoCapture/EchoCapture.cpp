@@ -0,0 +1,65 @@
+#include "EchoCapture.h"
+
+EchoCapture::EchoCapture(EchoSource& source, uint32_t timeoutUs)
+  : source_(source), timeoutUs_(timeoutUs) {}
+
+bool EchoCapture::startPing(uint32_t nowUs) {
+  if (state_.load(std::memory_order_acquire) != IDLE) return false;
+  pingUs_ = nowUs;
+  pings_++;
+  state_.store(WAIT_RISE, std::memory_order_release);
+  source_.trigger(nowUs);
+  return true;
+}
+
+void EchoCapture::onEdge(bool level, uint32_t timestampUs) {
+  uint32_t state = state_.load(std::memory_order_acquire);
+  if (state == WAIT_RISE && level) {
+    riseUs_ = timestampUs;
+    uint32_t expected = WAIT_RISE;
+    state_.compare_exchange_strong(expected, WAIT_FALL, std::memory_order_acq_rel);
+  } else if (state == WAIT_FALL && !level) {
+    finish(WAIT_FALL, IDLE, timestampUs - riseUs_, false);
+  } else if (state == DRAINING && !level) {
+    drained(timestampUs);
+  }
+}
+
+void EchoCapture::poll(uint32_t nowUs) {
+  uint32_t state = state_.load(std::memory_order_acquire);
+  if (state == IDLE) return;
+
+  if (state == DRAINING) {
+    if (nowUs - pingUs_ > MAX_BUSY_US) drained(nowUs);
+    return;
+  }
+
+  // Same budget pulseIn() had: the timeout covers the wait for the rising
+  // edge and the pulse itself.
+  if (nowUs - pingUs_ > timeoutUs_) {
+    gateUs_ = timeoutUs_;
+    // A high echo line means the sensor is still listening; wait it out
+    finish(state, state == WAIT_FALL ? DRAINING : IDLE, 0, true);
+  }
+}
+
+// Only the caller that wins the transition out of a waiting state reports
+// the ping, so a late edge racing a timeout can never post twice.
+bool EchoCapture::finish(uint32_t expected, uint32_t nextState, uint32_t echoUs, bool timedOut) {
+  uint32_t pingUs = pingUs_;
+  if (!state_.compare_exchange_strong(expected, nextState, std::memory_order_acq_rel)) return false;
+  if (timedOut) timeouts_++;
+  EchoResult result = { pingUs, echoUs, timedOut };
+  results_.push(result);
+  return true;
+}
+
+// The line fell after a timeout. pulseIn() would have waited until here,
+// capped at the full-range timeout; the difference is what the gate saved.
+void EchoCapture::drained(uint32_t nowUs) {
+  uint32_t expected = DRAINING;
+  if (!state_.compare_exchange_strong(expected, IDLE, std::memory_order_acq_rel)) return;
+  uint32_t busyUs = nowUs - pingUs_;
+  if (busyUs > DEFAULT_TIMEOUT_US) busyUs = DEFAULT_TIMEOUT_US;
+  if (busyUs > gateUs_) gatedSavedUs_ += busyUs - gateUs_;
+}
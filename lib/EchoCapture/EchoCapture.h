@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "EchoSource.h"
+#include "SpscQueue.h"
+
+// ===== Echo result =====
+struct EchoResult {
+  uint32_t pingUs;    // Time the ping was triggered
+  uint32_t echoUs;    // Width of the echo pulse (0 on timeout)
+  bool timedOut;
+};
+
+// ===== Capture statistics =====
+// Monotonic counters; take differences to get per-sweep figures.
+struct EchoStats {
+  uint32_t pings;
+  uint32_t timeouts;       // Pings that ended without an echo inside the timeout
+  uint32_t gatedSavedUs;   // Result latency saved versus the full-range timeout
+};
+
+// ===== Non-blocking echo capture =====
+// startPing() fires the trigger and returns immediately; the echo pulse is
+// timed from edge timestamps passed to onEdge() and the finished result is
+// posted to a completion queue drained with nextResult(). poll() must be
+// called regularly to retire pings that never produced an echo.
+//
+// The timeout can be shortened to gate out echoes beyond the range of
+// interest. The HC-SR04 ignores triggers while its echo line is high, so
+// after a gated timeout the result is posted at once but the capture stays
+// busy until the line falls (or MAX_BUSY_US passes).
+class EchoCapture {
+public:
+  static const uint32_t DEFAULT_TIMEOUT_US = 30000;  // ~400cm + margin, as pulseIn() used
+  static const uint32_t MAX_BUSY_US = 40000;         // HC-SR04 drops the line after ~38ms
+
+  explicit EchoCapture(EchoSource& source, uint32_t timeoutUs = DEFAULT_TIMEOUT_US);
+
+  bool startPing(uint32_t nowUs);
+  void onEdge(bool level, uint32_t timestampUs);  // ISR-safe
+  void poll(uint32_t nowUs);
+  bool nextResult(EchoResult& result) { return results_.pop(result); }
+
+  bool busy() const { return state_.load(std::memory_order_acquire) != IDLE; }
+  void setTimeoutUs(uint32_t timeoutUs) { timeoutUs_ = timeoutUs; }
+  uint32_t timeoutUs() const { return timeoutUs_; }
+  EchoStats stats() const { return { pings_, timeouts_, gatedSavedUs_ }; }
+
+  static float echoToCm(uint32_t echoUs) { return echoUs * 0.0343f / 2; }
+
+private:
+  enum State : uint32_t { IDLE, WAIT_RISE, WAIT_FALL, DRAINING };
+
+  bool finish(uint32_t expected, uint32_t nextState, uint32_t echoUs, bool timedOut);
+  void drained(uint32_t nowUs);
+
+  EchoSource& source_;
+  uint32_t timeoutUs_;
+  std::atomic<uint32_t> state_{IDLE};
+  volatile uint32_t pingUs_ = 0;
+  volatile uint32_t riseUs_ = 0;
+  volatile uint32_t gateUs_ = 0;  // Timeout that retired the ping being drained
+  volatile uint32_t pings_ = 0;
+  volatile uint32_t timeouts_ = 0;
+  volatile uint32_t gatedSavedUs_ = 0;
+  SpscQueue<EchoResult, 8> results_;
+};
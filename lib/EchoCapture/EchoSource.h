@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Echo source interface =====
+// Something that can fire an ultrasonic ping. Edges on the echo line are
+// reported back to EchoCapture::onEdge() by whoever observes them (a GPIO
+// interrupt on the ESP32, SimulatedEchoSource::advance() on the host).
+class EchoSource {
+public:
+  virtual ~EchoSource() {}
+  virtual void trigger(uint32_t nowUs) = 0;
+};
@@ -0,0 +1,35 @@
+#include "SimulatedEchoSource.h"
+
+bool SimulatedEchoSource::queueEchoUs(uint32_t echoUs) {
+  if (scriptCount_ >= SCRIPT_SIZE) return false;
+  script_[(scriptHead_ + scriptCount_) % SCRIPT_SIZE] = echoUs;
+  scriptCount_++;
+  return true;
+}
+
+void SimulatedEchoSource::trigger(uint32_t nowUs) {
+  triggers_++;
+  uint32_t echoUs = NO_ECHO;
+  if (scriptCount_ > 0) {
+    echoUs = script_[scriptHead_];
+    scriptHead_ = (scriptHead_ + 1) % SCRIPT_SIZE;
+    scriptCount_--;
+  }
+  if (echoUs == NO_ECHO) echoUs = noEchoPulseUs_;
+  pending_ = echoUs != 0;
+  risen_ = false;
+  riseAtUs_ = nowUs + responseDelayUs_;
+  fallAtUs_ = riseAtUs_ + echoUs;
+}
+
+void SimulatedEchoSource::advance(uint32_t nowUs) {
+  if (!pending_ || capture_ == nullptr) return;
+  if (!risen_ && (int32_t)(nowUs - riseAtUs_) >= 0) {
+    risen_ = true;
+    capture_->onEdge(true, riseAtUs_);
+  }
+  if (risen_ && (int32_t)(nowUs - fallAtUs_) >= 0) {
+    pending_ = false;
+    capture_->onEdge(false, fallAtUs_);
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "EchoCapture.h"
+
+// ===== Simulated echo source =====
+// Host-side stand-in for the HC-SR04. Each trigger consumes the next
+// scripted echo width (or distance); advance() delivers the rising and
+// falling edges to the capture engine once simulated time reaches them.
+// Like the real module, a ping with no echo holds the line high for
+// ~38ms before giving up.
+class SimulatedEchoSource : public EchoSource {
+public:
+  static const uint32_t NO_ECHO = 0;
+
+  SimulatedEchoSource() : capture_(nullptr) {}
+
+  void attach(EchoCapture& capture) { capture_ = &capture; }
+
+  // Scripted echo widths, consumed one per trigger; NO_ECHO never answers.
+  bool queueEchoUs(uint32_t echoUs);
+  bool queueDistanceCm(float cm) { return queueEchoUs(cm <= 0 ? NO_ECHO : (uint32_t)(cm * 2 / 0.0343f)); }
+  void setResponseDelayUs(uint32_t us) { responseDelayUs_ = us; }
+  void setNoEchoPulseUs(uint32_t us) { noEchoPulseUs_ = us; }
+
+  void trigger(uint32_t nowUs) override;
+  void advance(uint32_t nowUs);
+
+  uint32_t triggers() const { return triggers_; }
+
+private:
+  static const int SCRIPT_SIZE = 32;
+
+  EchoCapture* capture_;
+  uint32_t script_[SCRIPT_SIZE];
+  int scriptHead_ = 0;
+  int scriptCount_ = 0;
+  uint32_t responseDelayUs_ = 450;  // HC-SR04 burst time before the echo line rises
+  uint32_t noEchoPulseUs_ = 38000;
+
+  bool pending_ = false;
+  bool risen_ = false;
+  uint32_t riseAtUs_ = 0;
+  uint32_t fallAtUs_ = 0;
+  uint32_t triggers_ = 0;
+};
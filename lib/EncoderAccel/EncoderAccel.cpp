@@ -0,0 +1,29 @@
+#include "EncoderAccel.h"
+
+#include <stdlib.h>
+
+float EncoderAccel::step(int detents, uint32_t nowMs) {
+  if (detents == 0) return 0;
+
+  int direction = detents > 0 ? 1 : -1;
+  int clicks = abs(detents);
+
+  // Speed is judged per detent so several clicks in one poll still count
+  // as fast; a direction change always starts slow again.
+  multiplier_ = 1;
+  if (haveLast_ && direction == lastDirection_) {
+    uint32_t msPerDetent = (nowMs - lastMs_) / clicks;
+    uint16_t slow = config_.slowMsPerDetent;
+    uint16_t fast = config_.fastMsPerDetent;
+    if (msPerDetent <= fast) {
+      multiplier_ = config_.maxMultiplier;
+    } else if (msPerDetent < slow) {
+      multiplier_ = 1 + (int)((config_.maxMultiplier - 1) * (slow - msPerDetent) / (slow - fast));
+    }
+  }
+
+  lastMs_ = nowMs;
+  haveLast_ = true;
+  lastDirection_ = direction;
+  return direction * clicks * multiplier_ * config_.baseStep;
+}
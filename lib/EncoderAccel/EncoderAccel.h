@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Encoder acceleration =====
+// Turns detents into a range change whose size grows with spin speed.
+// A detent arriving slowMsPerDetent or more after the previous one moves
+// baseStep; at fastMsPerDetent or quicker it moves maxMultiplier steps,
+// with a linear ramp in between. Slow turns stay precise, a flick covers
+// the whole range in a few clicks.
+struct EncoderAccelConfig {
+  float baseStep;
+  uint16_t slowMsPerDetent;
+  uint16_t fastMsPerDetent;
+  uint8_t maxMultiplier;
+};
+
+class EncoderAccel {
+public:
+  explicit EncoderAccel(const EncoderAccelConfig& config) : config_(config) {}
+
+  // Change for `detents` clicks seen at nowMs (signed, whole base steps)
+  float step(int detents, uint32_t nowMs);
+  int lastMultiplier() const { return multiplier_; }
+
+private:
+  EncoderAccelConfig config_;
+  uint32_t lastMs_ = 0;
+  bool haveLast_ = false;
+  int lastDirection_ = 0;
+  int multiplier_ = 1;
+};
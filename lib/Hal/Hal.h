@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "EchoSource.h"  // Sensor: fires pings; edges go to EchoCapture
+#include "LcdFrame.h"    // Display: LcdSink receives changed cells
+
+// ===== Hardware abstraction =====
+// The few things the scan and detection logic touch, as small interfaces
+// with an ESP32 implementation in src/main.cpp and a Linux one in
+// src/native/. The sensor and the display already have interfaces of
+// their own (EchoSource, LcdSink) and are reused as they are.
+
+// Free-running time since boot; both counters wrap
+class HalClock {
+public:
+  virtual ~HalClock() {}
+  virtual uint32_t millis() = 0;
+  virtual uint32_t micros() = 0;
+};
+
+// Radar servo, 0..180 degrees
+class HalServo {
+public:
+  virtual ~HalServo() {}
+  virtual void write(int angle) = 0;
+};
+
+// Detection indicators (LED and buzzer on the device)
+class HalOutputs {
+public:
+  virtual ~HalOutputs() {}
+  virtual void setAlarm(bool on) = 0;
+};
+
+// Live sample push to connected clients, plus servicing of the network
+// stack. poll() may sleep up to timeoutMs waiting for traffic.
+class HalNetwork {
+public:
+  virtual ~HalNetwork() {}
+  virtual bool hasSubscribers() = 0;  // Lets callers skip building a message
+  virtual void broadcast(const char* text, size_t len) = 0;
+  virtual void poll(uint32_t timeoutMs) = 0;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Hal.h"
+
+// ===== Virtual clock =====
+// Time that only moves when told to. Lets the host run the scan faster
+// than real time, and makes runs repeatable: the same inputs give the
+// same timestamps.
+class VirtualClock : public HalClock {
+public:
+  uint32_t millis() override { return (uint32_t)(nowUs_ / 1000); }
+  uint32_t micros() override { return (uint32_t)nowUs_; }
+
+  uint64_t nowUs() const { return nowUs_; }
+  void advanceUs(uint64_t us) { nowUs_ += us; }
+  void advanceMs(uint32_t ms) { nowUs_ += (uint64_t)ms * 1000; }
+
+private:
+  uint64_t nowUs_ = 0;
+};
@@ -0,0 +1,416 @@
+#include "HttpServer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef ESP_PLATFORM
+#include <lwip/sockets.h>
+#else
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static uint32_t nowMs() { return millis(); }
+static void sleepMs(uint32_t ms) { delay(ms); }  // vTaskDelay() on the ESP32
+#else
+#include <chrono>
+static uint32_t nowMs() {
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+static void sleepMs(uint32_t ms) { usleep(ms * 1000); }
+#endif
+
+// ===== Helpers =====
+static const char* statusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+static bool setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool wouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+// ===== Request =====
+bool HttpRequest::isHead() const {
+  return strcmp(method_, "HEAD") == 0;
+}
+
+bool HttpRequest::header(const char* name, char* out, size_t outSize) const {
+  size_t nameLen = strlen(name);
+  const char* line = headers_;
+  while (*line) {
+    const char* eol = strstr(line, "\r\n");
+    if (eol == nullptr) eol = line + strlen(line);
+    if ((size_t)(eol - line) > nameLen && line[nameLen] == ':' && strncasecmp(line, name, nameLen) == 0) {
+      const char* value = line + nameLen + 1;
+      while (value < eol && (*value == ' ' || *value == '\t')) value++;
+      size_t len = eol - value;
+      if (len >= outSize) len = outSize - 1;
+      memcpy(out, value, len);
+      out[len] = '\0';
+      return true;
+    }
+    if (*eol == '\0') break;
+    line = eol + 2;
+  }
+  return false;
+}
+
+bool HttpRequest::headerEquals(const char* name, const char* value) const {
+  char buffer[96];
+  return header(name, buffer, sizeof(buffer)) && strcmp(buffer, value) == 0;
+}
+
+// ===== Response =====
+void HttpResponse::reset(char* head, char* body) {
+  head_ = head;
+  body_ = body;
+  headLen_ = 0;
+  status_ = 0;
+  contentType_ = nullptr;
+  data_ = nullptr;
+  dataLen_ = 0;
+}
+
+void HttpResponse::addHeader(const char* name, const char* value) {
+  int n = snprintf(head_ + headLen_, HTTP_HEAD_SIZE - headLen_, "%s: %s\r\n", name, value);
+  if (n > 0 && headLen_ + n < HTTP_HEAD_SIZE) headLen_ += n;
+}
+
+void HttpResponse::send(int status, const char* contentType, size_t len) {
+  status_ = status;
+  contentType_ = contentType;
+  data_ = (const uint8_t*)body_;
+  dataLen_ = len < HTTP_BODY_SIZE ? len : HTTP_BODY_SIZE;
+}
+
+void HttpResponse::send(int status, const char* contentType, const char* text) {
+  size_t len = strlen(text);
+  if (len > HTTP_BODY_SIZE) len = HTTP_BODY_SIZE;
+  memcpy(body_, text, len);
+  send(status, contentType, len);
+}
+
+void HttpResponse::sendStatic(int status, const char* contentType, const uint8_t* data, size_t len) {
+  status_ = status;
+  contentType_ = contentType;
+  data_ = data;
+  dataLen_ = len;
+}
+
+void HttpResponse::sendEmpty(int status) {
+  sendStatic(status, nullptr, nullptr, 0);
+}
+
+// ===== Server =====
+bool HttpServer::begin() {
+  for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    conns_[i].fd = -1;
+    conns_[i].state = CONN_FREE;
+  }
+
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) return false;
+
+  int yes = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port_);
+
+  if (bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+      listen(listenFd_, HTTP_MAX_CONNECTIONS) != 0 || !setNonBlocking(listenFd_)) {
+    close(listenFd_);
+    listenFd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+void HttpServer::on(const char* path, HttpHandler handler) {
+  if (routeCount_ >= HTTP_MAX_ROUTES) return;
+  routes_[routeCount_].path = path;
+  routes_[routeCount_].handler = handler;
+  routeCount_++;
+}
+
+int HttpServer::activeConnections() const {
+  int count = 0;
+  for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    if (conns_[i].state != CONN_FREE) count++;
+  }
+  return count;
+}
+
+void HttpServer::poll(uint32_t timeoutMs) {
+  // Not listening (begin() failed or wasn't called): still take the time,
+  // so a task looping on poll() sleeps instead of spinning
+  if (listenFd_ < 0) {
+    sleepMs(timeoutMs);
+    return;
+  }
+
+  // Pipelined requests left in rx are served one per connection per poll,
+  // so a burst of them can't recurse or starve the other clients
+  for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    Connection& conn = conns_[i];
+    if (conn.state == CONN_READING && conn.rxLen > 0) dispatch(conn);
+  }
+
+  fd_set readSet, writeSet;
+  FD_ZERO(&readSet);
+  FD_ZERO(&writeSet);
+  int maxFd = -1;
+
+  // Only listen while a slot is free; excess clients wait in the backlog
+  if (activeConnections() < HTTP_MAX_CONNECTIONS) {
+    FD_SET(listenFd_, &readSet);
+    maxFd = listenFd_;
+  }
+  bool buffered = false;
+  for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    Connection& conn = conns_[i];
+    if (conn.state == CONN_READING) FD_SET(conn.fd, &readSet);
+    else if (conn.state == CONN_WRITING) FD_SET(conn.fd, &writeSet);
+    else continue;
+    if (conn.fd > maxFd) maxFd = conn.fd;
+    if (conn.state == CONN_READING && hasRequest(conn)) buffered = true;
+  }
+
+  // Don't sleep on the socket while a complete request is already buffered
+  if (buffered) timeoutMs = 0;
+  struct timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+  int ready = maxFd < 0 ? 0 : select(maxFd + 1, &readSet, &writeSet, nullptr, &tv);
+
+  if (ready > 0) {
+    if (FD_ISSET(listenFd_, &readSet)) acceptClients();
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+      Connection& conn = conns_[i];
+      if (conn.state == CONN_READING && FD_ISSET(conn.fd, &readSet)) readClient(conn);
+      else if (conn.state == CONN_WRITING && FD_ISSET(conn.fd, &writeSet)) writeClient(conn);
+    }
+  }
+
+  // Drop idle keep-alive connections so they can't hold slots forever
+  uint32_t now = nowMs();
+  for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    Connection& conn = conns_[i];
+    if (conn.state != CONN_FREE && now - conn.lastActivityMs > HTTP_IDLE_TIMEOUT_MS) closeClient(conn);
+  }
+}
+
+void HttpServer::acceptClients() {
+  for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+    Connection& conn = conns_[i];
+    if (conn.state != CONN_FREE) continue;
+
+    int fd = accept(listenFd_, nullptr, nullptr);
+    if (fd < 0) return;
+    if (!setNonBlocking(fd)) {
+      close(fd);
+      continue;
+    }
+    conn.fd = fd;
+    conn.state = CONN_READING;
+    conn.lastActivityMs = nowMs();
+    conn.rxLen = 0;
+  }
+}
+
+void HttpServer::readClient(Connection& conn) {
+  ssize_t n = recv(conn.fd, conn.rx + conn.rxLen, HTTP_RX_SIZE - conn.rxLen, 0);
+  if (n == 0 || (n < 0 && !wouldBlock())) {
+    closeClient(conn);
+    return;
+  }
+  if (n < 0) return;
+
+  conn.rxLen += n;
+  conn.rx[conn.rxLen] = '\0';
+  conn.lastActivityMs = nowMs();
+
+  if (!dispatch(conn) && conn.rxLen >= HTTP_RX_SIZE) {
+    // Headers don't fit the fixed buffer
+    conn.response.reset(conn.head, conn.body);
+    conn.response.send(431, "text/plain", "Headers too large\n");
+    conn.keepAlive = false;
+    conn.requestLen = conn.rxLen;
+    finishHead(conn, false);
+  }
+}
+
+bool HttpServer::hasRequest(const Connection& conn) const {
+  return conn.rxLen > 0 && strstr(conn.rx, "\r\n\r\n") != nullptr;
+}
+
+// Parses one complete request from rx and runs its handler. Returns false
+// while the header block is still incomplete.
+bool HttpServer::dispatch(Connection& conn) {
+  char* end = strstr(conn.rx, "\r\n\r\n");
+  if (end == nullptr) return false;
+
+  conn.requestLen = end + 4 - conn.rx;
+  end[2] = '\0';  // Header block keeps the CRLF of its last line
+
+  HttpRequest request;
+  HttpResponse& response = conn.response;
+  response.reset(conn.head, conn.body);
+
+  char* lineEnd = strstr(conn.rx, "\r\n");
+  *lineEnd = '\0';
+  request.headers_ = lineEnd + 2;
+
+  char* method = conn.rx;
+  char* target = strchr(method, ' ');
+  char* version = target ? strchr(target + 1, ' ') : nullptr;
+  if (version == nullptr || strncmp(version + 1, "HTTP/1.", 7) != 0) {
+    conn.keepAlive = false;
+    response.send(400, "text/plain", "Bad request\n");
+    finishHead(conn, false);
+    return true;
+  }
+  *target++ = '\0';
+  *version++ = '\0';
+  request.method_ = method;
+  request.path_ = target;
+  request.minorVersion_ = version[7] == '0' ? 0 : 1;
+
+  char* query = strchr(target, '?');
+  if (query) {
+    *query++ = '\0';
+    request.query_ = query;
+  }
+
+  // HTTP/1.1 keeps the connection open unless asked not to; 1.0 the reverse
+  if (request.minorVersion_ == 0) conn.keepAlive = request.headerEquals("Connection", "keep-alive");
+  else conn.keepAlive = !request.headerEquals("Connection", "close");
+
+  char length[16];
+  if (request.header("Content-Length", length, sizeof(length)) && atoi(length) > 0) {
+    // Request bodies are not supported; the unread body poisons keep-alive
+    conn.keepAlive = false;
+    response.send(413, "text/plain", "Request bodies not supported\n");
+  } else if (strcmp(request.method_, "GET") != 0 && !request.isHead()) {
+    response.send(405, "text/plain", "Method not allowed\n");
+  } else {
+    HttpHandler handler = nullptr;
+    for (int i = 0; i < routeCount_; i++) {
+      if (strcmp(routes_[i].path, request.path_) == 0) {
+        handler = routes_[i].handler;
+        break;
+      }
+    }
+    if (handler == nullptr) response.send(404, "text/plain", "Not found\n");
+    else handler(request, response);
+    if (!response.sent()) response.send(500, "text/plain", "No response\n");
+  }
+
+  finishHead(conn, request.isHead());
+  return true;
+}
+
+// Builds the status line and standard headers in front of any headers the
+// handler added, then switches the connection to writing.
+void HttpServer::finishHead(Connection& conn, bool isHead) {
+  HttpResponse& response = conn.response;
+  char prefix[160];
+  int prefixLen = snprintf(prefix, sizeof(prefix),
+                           "HTTP/1.1 %d %s\r\nContent-Length: %u\r\nConnection: %s\r\n",
+                           response.status_, statusText(response.status_), (unsigned)response.dataLen_,
+                           conn.keepAlive ? "keep-alive" : "close");
+  if (response.contentType_ && prefixLen < (int)sizeof(prefix)) {
+    prefixLen += snprintf(prefix + prefixLen, sizeof(prefix) - prefixLen, "Content-Type: %s\r\n",
+                          response.contentType_);
+  }
+  if (prefixLen >= (int)sizeof(prefix)) prefixLen = sizeof(prefix) - 1;
+
+  size_t extraLen = response.headLen_;
+  if (prefixLen + extraLen + 2 > HTTP_HEAD_SIZE) extraLen = HTTP_HEAD_SIZE - prefixLen - 2;
+  memmove(conn.head + prefixLen, conn.head, extraLen);
+  memcpy(conn.head, prefix, prefixLen);
+  memcpy(conn.head + prefixLen + extraLen, "\r\n", 2);
+  response.headLen_ = prefixLen + extraLen + 2;
+
+  conn.headSent = 0;
+  conn.bodySent = isHead ? response.dataLen_ : 0;
+  conn.state = CONN_WRITING;
+  writeClient(conn);
+}
+
+void HttpServer::writeClient(Connection& conn) {
+  HttpResponse& response = conn.response;
+
+  while (conn.headSent < response.headLen_ || conn.bodySent < response.dataLen_) {
+    const uint8_t* chunk;
+    size_t remaining;
+    if (conn.headSent < response.headLen_) {
+      chunk = (const uint8_t*)conn.head + conn.headSent;
+      remaining = response.headLen_ - conn.headSent;
+    } else {
+      chunk = response.data_ + conn.bodySent;
+      remaining = response.dataLen_ - conn.bodySent;
+    }
+
+    ssize_t n = ::send(conn.fd, chunk, remaining, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (!wouldBlock()) closeClient(conn);
+      return;  // Socket full; select() resumes us
+    }
+    conn.lastActivityMs = nowMs();
+    if (conn.headSent < response.headLen_) conn.headSent += n;
+    else conn.bodySent += n;
+  }
+
+  requestsServed_++;
+  if (!conn.keepAlive) {
+    closeClient(conn);
+    return;
+  }
+
+  // Keep any pipelined bytes that arrived behind this request; poll()
+  // dispatches them next round rather than recursing from here
+  conn.rxLen -= conn.requestLen;
+  memmove(conn.rx, conn.rx + conn.requestLen, conn.rxLen);
+  conn.rx[conn.rxLen] = '\0';
+  conn.state = CONN_READING;
+}
+
+void HttpServer::closeClient(Connection& conn) {
+  if (conn.fd >= 0) close(conn.fd);
+  conn.fd = -1;
+  conn.state = CONN_FREE;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Limits =====
+// Every connection owns fixed buffers, so memory use is bounded by
+// HTTP_MAX_CONNECTIONS no matter how many clients show up.
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 4
+#endif
+#ifndef HTTP_MAX_ROUTES
+#define HTTP_MAX_ROUTES 12
+#endif
+
+const size_t HTTP_RX_SIZE = 1024;    // Request line + headers
+const size_t HTTP_HEAD_SIZE = 320;   // Status line + response headers
+const size_t HTTP_BODY_SIZE = 6144;  // Dynamic response body; /metrics is the largest
+const uint32_t HTTP_IDLE_TIMEOUT_MS = 5000;
+
+// ===== Request =====
+class HttpRequest {
+public:
+  const char* method() const { return method_; }
+  const char* path() const { return path_; }
+  const char* query() const { return query_; }  // Empty if none
+  bool isHead() const;
+
+  // Case-insensitive lookup; copies the value into out. False if missing.
+  bool header(const char* name, char* out, size_t outSize) const;
+  bool headerEquals(const char* name, const char* value) const;
+
+private:
+  friend class HttpServer;
+  const char* method_ = "";
+  const char* path_ = "";
+  const char* query_ = "";
+  const char* headers_ = "";  // Raw header block, CRLF separated
+  int minorVersion_ = 1;
+};
+
+// ===== Response =====
+// Handlers either format a body into the connection's fixed buffer
+// (body()/send()) or point at constant data that is streamed without a
+// copy (sendStatic()).
+class HttpResponse {
+public:
+  void addHeader(const char* name, const char* value);
+
+  char* body() { return body_; }
+  size_t bodyCapacity() const { return HTTP_BODY_SIZE; }
+
+  // Body already written to body(), len bytes
+  void send(int status, const char* contentType, size_t len);
+  // Copies text into the body buffer (truncated to capacity)
+  void send(int status, const char* contentType, const char* text);
+  void sendStatic(int status, const char* contentType, const uint8_t* data, size_t len);
+  void sendEmpty(int status);
+
+  bool sent() const { return status_ != 0; }
+
+private:
+  friend class HttpServer;
+  void reset(char* head, char* body);
+
+  char* head_ = nullptr;
+  char* body_ = nullptr;
+  size_t headLen_ = 0;  // Extra headers collected so far, then full head
+  int status_ = 0;
+  const char* contentType_ = nullptr;
+  const uint8_t* data_ = nullptr;
+  size_t dataLen_ = 0;
+};
+
+typedef void (*HttpHandler)(const HttpRequest& request, HttpResponse& response);
+
+// ===== Server =====
+// Single-threaded, event-driven HTTP/1.1 server on non-blocking BSD
+// sockets (lwIP on the ESP32, POSIX on a host). poll() multiplexes the
+// listener and all connections with select(), so several clients are
+// served concurrently and keep-alive connections are reused.
+class HttpServer {
+public:
+  explicit HttpServer(uint16_t port) : port_(port) {}
+
+  bool begin();  // False if the socket cannot listen; poll() then only sleeps
+  void on(const char* path, HttpHandler handler);
+  void poll(uint32_t timeoutMs);  // Waits at most timeoutMs for activity
+
+  uint32_t requestsServed() const { return requestsServed_; }
+  int activeConnections() const;
+
+private:
+  enum ConnState { CONN_FREE, CONN_READING, CONN_WRITING };
+
+  struct Connection {
+    int fd;
+    ConnState state;
+    uint32_t lastActivityMs;
+    bool keepAlive;
+    char rx[HTTP_RX_SIZE + 1];
+    size_t rxLen;
+    size_t requestLen;  // Bytes of rx consumed by the request being answered
+    char head[HTTP_HEAD_SIZE];
+    char body[HTTP_BODY_SIZE];
+    HttpResponse response;
+    size_t headSent;
+    size_t bodySent;
+  };
+
+  struct Route {
+    const char* path;
+    HttpHandler handler;
+  };
+
+  void acceptClients();
+  void readClient(Connection& conn);
+  void writeClient(Connection& conn);
+  bool hasRequest(const Connection& conn) const;
+  bool dispatch(Connection& conn);
+  void finishHead(Connection& conn, bool isHead);
+  void closeClient(Connection& conn);
+
+  uint16_t port_;
+  int listenFd_ = -1;
+  Route routes_[HTTP_MAX_ROUTES];
+  int routeCount_ = 0;
+  Connection conns_[HTTP_MAX_CONNECTIONS];
+  uint32_t requestsServed_ = 0;
+};
@@ -0,0 +1,154 @@
+#include "JsonWriter.h"
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {
+  if (capacity_ > 0) buffer_[0] = '\0';
+  else overflow_ = true;
+}
+
+// Emits the comma before a value or key unless it is the first in its
+// container or directly follows a key.
+void JsonWriter::separator() {
+  if (afterKey_) {
+    afterKey_ = false;
+    return;
+  }
+  if (depth_ == 0) return;
+  uint32_t bit = 1u << (depth_ - 1);
+  if (hasItems_ & bit) put(',');
+  hasItems_ |= bit;
+}
+
+void JsonWriter::put(char c) {
+  // Keep one byte for the terminator
+  if (length_ + 1 >= capacity_) {
+    overflow_ = true;
+    return;
+  }
+  buffer_[length_++] = c;
+  buffer_[length_] = '\0';
+}
+
+void JsonWriter::put(const char* text) {
+  while (*text) put(*text++);
+}
+
+void JsonWriter::putUnsigned(uint64_t number) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = '0' + number % 10;
+    number /= 10;
+  } while (number);
+  while (n) put(digits[--n]);
+}
+
+JsonWriter& JsonWriter::beginObject() {
+  separator();
+  put('{');
+  if (depth_ < MAX_DEPTH) hasItems_ &= ~(1u << depth_);
+  depth_++;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  if (depth_ > 0) depth_--;
+  put('}');
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  separator();
+  put('[');
+  if (depth_ < MAX_DEPTH) hasItems_ &= ~(1u << depth_);
+  depth_++;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  if (depth_ > 0) depth_--;
+  put(']');
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(const char* name) {
+  value(name);
+  put(':');
+  afterKey_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(long long number) {
+  separator();
+  if (number < 0) {
+    put('-');
+    putUnsigned(0 - (uint64_t)number);
+  } else {
+    putUnsigned((uint64_t)number);
+  }
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(unsigned long long number) {
+  separator();
+  putUnsigned(number);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(float number, uint8_t decimals) {
+  if (decimals > 6) decimals = 6;
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+
+  // NaN fails every comparison; also reject values whose scaled form
+  // doesn't fit the uint64_t conversion below (UINT64_MAX is ~1.8e19)
+  bool negative = number < 0;
+  double magnitude = negative ? -(double)number : (double)number;
+  if (!(magnitude * scale < 1.8e19)) return null();
+
+  separator();
+  uint64_t scaled = (uint64_t)(magnitude * scale + 0.5);
+  if (negative && scaled != 0) put('-');
+
+  putUnsigned(scaled / scale);
+  if (decimals == 0) return *this;
+
+  put('.');
+  uint32_t fraction = scaled % scale;
+  for (uint32_t digit = scale / 10; digit > 0; digit /= 10) {
+    put('0' + (fraction / digit) % 10);
+  }
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+  separator();
+  put(flag ? "true" : "false");
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+  separator();
+  put('"');
+  for (; *text; text++) {
+    char c = *text;
+    if (c == '"' || c == '\\') {
+      put('\\');
+      put(c);
+    } else if ((uint8_t)c < 0x20) {
+      static const char HEX_DIGITS[] = "0123456789abcdef";
+      put("\\u00");
+      put(HEX_DIGITS[(c >> 4) & 0xf]);
+      put(HEX_DIGITS[c & 0xf]);
+    } else {
+      put(c);
+    }
+  }
+  put('"');
+  return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+  separator();
+  put("null");
+  return *this;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Streaming JSON writer =====
+// Writes JSON straight into a caller-owned buffer (an HTTP response body,
+// a stack array) with no heap use. Commas are inserted automatically.
+// Numbers are formatted by hand because newlib's float printf can
+// allocate. If the buffer fills up, the writer stops writing and
+// overflowed() turns true; the output is then truncated and should not be
+// sent.
+class JsonWriter {
+public:
+  JsonWriter(char* buffer, size_t capacity);
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+
+  JsonWriter& key(const char* name);
+  // All four widths so int32_t/uint32_t match whichever type they alias
+  JsonWriter& value(int number) { return value((long long)number); }
+  JsonWriter& value(unsigned number) { return value((unsigned long long)number); }
+  JsonWriter& value(long number) { return value((long long)number); }
+  JsonWriter& value(unsigned long number) { return value((unsigned long long)number); }
+  JsonWriter& value(long long number);
+  JsonWriter& value(unsigned long long number);
+  JsonWriter& value(float number, uint8_t decimals);  // NaN/inf become null
+  JsonWriter& value(bool flag);
+  JsonWriter& value(const char* text);
+  JsonWriter& null();
+
+  // key + value shorthands
+  template <typename T>
+  JsonWriter& field(const char* name, T v) { return key(name).value(v); }
+  JsonWriter& field(const char* name, float v, uint8_t decimals) { return key(name).value(v, decimals); }
+
+  const char* c_str() const { return buffer_; }
+  size_t length() const { return length_; }
+  bool overflowed() const { return overflow_; }
+
+private:
+  static const int MAX_DEPTH = 16;
+
+  void separator();
+  void put(char c);
+  void put(const char* text);
+  void putUnsigned(uint64_t number);
+
+  char* buffer_;
+  size_t capacity_;
+  size_t length_ = 0;
+  bool overflow_ = false;
+  int depth_ = 0;
+  uint32_t hasItems_ = 0;  // Bit per nesting level: already holds a value
+  bool afterKey_ = false;
+};
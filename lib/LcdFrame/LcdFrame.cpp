@@ -0,0 +1,84 @@
+#include "LcdFrame.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// A cursor command costs about as much as one character, so short
+// unchanged gaps are cheaper to resend than to skip.
+static const uint8_t MAX_GAP = 1;
+
+LcdFrame::LcdFrame() {
+  clear();
+  invalidate();
+}
+
+void LcdFrame::clear() {
+  memset(&back_, ' ', sizeof(back_));
+}
+
+void LcdFrame::invalidate() {
+  // No printable character matches, so every cell differs
+  memset(&front_, 0, sizeof(front_));
+}
+
+bool LcdFrame::dirty() const {
+  return memcmp(&back_, &front_, sizeof(back_)) != 0;
+}
+
+void LcdFrame::print(uint8_t col, uint8_t row, const char* text) {
+  if (row >= ROWS) return;
+  for (; col < COLS && *text; col++, text++) back_.cells[row][col] = *text;
+}
+
+void LcdFrame::vprint(uint8_t col, uint8_t row, bool pad, const char* format, va_list args) {
+  if (row >= ROWS || col >= COLS) return;
+  char text[COLS + 1];
+  int len = vsnprintf(text, sizeof(text), format, args);
+  if (len < 0) return;
+  if (len > COLS - col) len = COLS - col;
+  memcpy(&back_.cells[row][col], text, len);
+  if (pad) memset(&back_.cells[row][col + len], ' ', COLS - col - len);
+}
+
+void LcdFrame::printf(uint8_t col, uint8_t row, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vprint(col, row, false, format, args);
+  va_end(args);
+}
+
+void LcdFrame::printLine(uint8_t row, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  vprint(0, row, true, format, args);
+  va_end(args);
+}
+
+size_t LcdFrame::flush(LcdSink& sink) {
+  size_t bytes = 0;
+  for (uint8_t row = 0; row < ROWS; row++) {
+    uint8_t col = 0;
+    while (col < COLS) {
+      if (back_.cells[row][col] == front_.cells[row][col]) {
+        col++;
+        continue;
+      }
+
+      // Extend the run across gaps of up to MAX_GAP unchanged cells
+      uint8_t end = col + 1;
+      uint8_t last = col;
+      while (end < COLS && end - last <= MAX_GAP + 1) {
+        if (back_.cells[row][end] != front_.cells[row][end]) last = end;
+        end++;
+      }
+      uint8_t len = last - col + 1;
+
+      sink.setCursor(col, row);
+      sink.write(&back_.cells[row][col], len);
+      memcpy(&front_.cells[row][col], &back_.cells[row][col], len);
+      bytes += 1 + len;
+      col = last + 1;
+    }
+  }
+  return bytes;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== LCD sink =====
+// Where a frame's changes go: the real HD44780 on the device, a byte
+// counter on a host.
+class LcdSink {
+public:
+  virtual ~LcdSink() {}
+  virtual void setCursor(uint8_t col, uint8_t row) = 0;
+  virtual void write(const char* text, size_t len) = 0;
+};
+
+// ===== Screen contents =====
+struct LcdScreen {
+  char cells[2][16];
+};
+
+// ===== LCD frame buffer =====
+// Keeps the 16x2 screen in RAM twice: what the code wants shown (back)
+// and what the display is known to show (front). Drawing only touches
+// RAM; flush() sends just the runs of cells that differ, each preceded by
+// one cursor command. Formatting goes into fixed buffers. Callers should
+// format numbers with integer conversions, because newlib's %f can
+// allocate.
+class LcdFrame {
+public:
+  static const uint8_t COLS = sizeof(LcdScreen::cells[0]);
+  static const uint8_t ROWS = sizeof(LcdScreen::cells) / COLS;
+
+  LcdFrame();
+
+  void clear();  // Blanks the back buffer; costs nothing until flush()
+  void print(uint8_t col, uint8_t row, const char* text);
+  void printf(uint8_t col, uint8_t row, const char* format, ...) __attribute__((format(printf, 4, 5)));
+  // Whole row, padded with spaces so stale characters disappear
+  void printLine(uint8_t row, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+  // Sends changed cells to the sink and returns the LCD bytes it cost
+  // (characters plus cursor commands)
+  size_t flush(LcdSink& sink);
+  void invalidate();  // Display contents unknown: next flush redraws all
+  bool dirty() const;
+
+  char cell(uint8_t col, uint8_t row) const { return back_.cells[row][col]; }
+
+  // Whole-screen copies, for handing a drawn screen to another task
+  const LcdScreen& screen() const { return back_; }
+  void load(const LcdScreen& screen) { back_ = screen; }
+  void markShown() { front_ = back_; }  // Handed off elsewhere; not dirty
+
+private:
+  void vprint(uint8_t col, uint8_t row, bool pad, const char* format, va_list args);
+
+  LcdScreen back_;
+  LcdScreen front_;
+};
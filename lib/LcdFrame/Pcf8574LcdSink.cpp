@@ -0,0 +1,39 @@
+#include "Pcf8574LcdSink.h"
+
+static const uint8_t ROW_OFFSETS[] = { 0x00, 0x40 };
+static const uint8_t CMD_SET_DDRAM = 0x80;
+
+void Pcf8574LcdSink::setCursor(uint8_t col, uint8_t row) {
+  if (row >= sizeof(ROW_OFFSETS)) row = sizeof(ROW_OFFSETS) - 1;
+  sendByte(CMD_SET_DDRAM | (col + ROW_OFFSETS[row]), false);
+}
+
+void Pcf8574LcdSink::write(const char* text, size_t len) {
+  for (size_t i = 0; i < len; i++) sendByte((uint8_t)text[i], true);
+}
+
+// Each nibble is latched by an EN high then EN low write. At I2C speeds
+// one expander byte takes >20us, which covers the HD44780's EN pulse
+// width and, across the next character's bytes, its 37us execution time.
+void Pcf8574LcdSink::sendByte(uint8_t value, bool isData) {
+  uint8_t mode = (isData ? RS : 0) | backlight_;
+  uint8_t high = (value & 0xF0) | mode;
+  uint8_t low = ((value << 4) & 0xF0) | mode;
+  push(high | EN);
+  push(high);
+  push(low | EN);
+  push(low);
+}
+
+void Pcf8574LcdSink::push(uint8_t expanderBits) {
+  if (batchLen_ == BATCH_SIZE) flush();
+  batch_[batchLen_++] = expanderBits;
+}
+
+void Pcf8574LcdSink::flush() {
+  if (batchLen_ == 0) return;
+  i2cWrite_(address_, batch_, batchLen_);
+  transactions_++;
+  bytesSent_ += batchLen_ + 1;  // Plus the address byte
+  batchLen_ = 0;
+}
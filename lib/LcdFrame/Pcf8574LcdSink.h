@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "LcdFrame.h"
+
+// ===== Batched PCF8574 LCD sink =====
+// Drives an HD44780 behind the common PCF8574 I2C backpack (P0=RS, P2=EN,
+// P3=backlight, P4-P7=D4-D7) in 4-bit mode. LiquidCrystal_I2C sends every
+// expander write as its own I2C transaction, six per character. Here the
+// expander bytes for a whole run of cells are packed into one transaction
+// of up to BATCH_SIZE bytes. The display must already be initialised,
+// e.g. by LiquidCrystal_I2C::init().
+//
+// The transport is a plain function so the byte stream can be counted on
+// a host.
+typedef void (*I2cWriteFn)(uint8_t address, const uint8_t* data, size_t len);
+
+class Pcf8574LcdSink : public LcdSink {
+public:
+  static const size_t BATCH_SIZE = 64;  // Fits the ESP32 Wire buffer
+
+  Pcf8574LcdSink(uint8_t address, I2cWriteFn write) : address_(address), i2cWrite_(write) {}
+
+  void setCursor(uint8_t col, uint8_t row) override;
+  void write(const char* text, size_t len) override;
+  void flush();  // Sends whatever is still batched
+
+  void setBacklight(bool on) { backlight_ = on ? BACKLIGHT : 0; }
+
+  uint32_t transactions() const { return transactions_; }
+  uint32_t bytesSent() const { return bytesSent_; }
+
+private:
+  static const uint8_t RS = 0x01;
+  static const uint8_t EN = 0x04;
+  static const uint8_t BACKLIGHT = 0x08;
+
+  void sendByte(uint8_t value, bool isData);
+  void push(uint8_t expanderBits);
+
+  uint8_t address_;
+  I2cWriteFn i2cWrite_;
+  uint8_t backlight_ = BACKLIGHT;
+  uint8_t batch_[BATCH_SIZE];
+  size_t batchLen_ = 0;
+  uint32_t transactions_ = 0;
+  uint32_t bytesSent_ = 0;
+};
@@ -0,0 +1,79 @@
+#include "Log.h"
+
+#include <stdio.h>
+
+LogRing::LogRing(ClockFn clock) : clock_(clock) {
+  for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool LogRing::write(LogLevel level, const char* module, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  bool ok = vwrite(level, module, format, args);
+  va_end(args);
+  return ok;
+}
+
+// A cell whose sequence equals the enqueue position is free for that
+// lap. Claiming it is one CAS; the record is then filled in privately
+// and handed over by storing position + 1.
+bool LogRing::vwrite(LogLevel level, const char* module, const char* format, va_list args) {
+  uint32_t pos = enqueuePos_.load(std::memory_order_relaxed);
+  Cell* cell;
+  for (;;) {
+    cell = &cells_[pos & MASK];
+    uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(sequence - pos);
+    if (diff == 0) {
+      if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);  // Full
+      return false;
+    } else {
+      pos = enqueuePos_.load(std::memory_order_relaxed);  // Lost a race
+    }
+  }
+
+  LogRecord& record = cell->record;
+  record.timeMs = clock_ ? (uint32_t)clock_() : 0;
+  record.level = level;
+  record.module = module;
+  vsnprintf(record.text, sizeof(record.text), format, args);
+
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  written_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool LogRing::pop(LogRecord& record) {
+  uint32_t pos = dequeuePos_.load(std::memory_order_relaxed);
+  Cell* cell;
+  for (;;) {
+    cell = &cells_[pos & MASK];
+    uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    int32_t diff = (int32_t)(sequence - (pos + 1));
+    if (diff == 0) {
+      if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      return false;  // Empty, or the next record is still being written
+    } else {
+      pos = dequeuePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  record = cell->record;
+  cell->sequence.store(pos + LOG_RING_SIZE, std::memory_order_release);
+  return true;
+}
+
+char LogRing::levelChar(LogLevel level) {
+  switch (level) {
+    case LOG_LEVEL_ERROR: return 'E';
+    case LOG_LEVEL_WARN: return 'W';
+    case LOG_LEVEL_INFO: return 'I';
+    case LOG_LEVEL_DEBUG: return 'D';
+    default: return '-';
+  }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Log levels =====
+enum LogLevel : uint8_t {
+  LOG_LEVEL_NONE = 0,
+  LOG_LEVEL_ERROR,
+  LOG_LEVEL_WARN,
+  LOG_LEVEL_INFO,
+  LOG_LEVEL_DEBUG,
+};
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 32  // Records; power of two
+#endif
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX 96   // Formatted message, longer ones are cut
+#endif
+
+struct LogRecord {
+  uint32_t timeMs;
+  LogLevel level;
+  const char* module;
+  char text[LOG_LINE_MAX];
+};
+
+// ===== Log ring =====
+// Bounded lock-free multi-producer / multi-consumer queue of fixed
+// records (Vyukov's sequence-per-cell ring). write() formats straight
+// into a claimed cell and never waits: when the ring is full the line is
+// counted in dropped() and thrown away. A drain task pops records and
+// does the slow UART work. Not for ISRs: vsnprintf is too heavy there.
+class LogRing {
+public:
+  typedef unsigned long (*ClockFn)();
+
+  explicit LogRing(ClockFn clock);
+
+  bool write(LogLevel level, const char* module, const char* format, ...)
+      __attribute__((format(printf, 4, 5)));
+  bool vwrite(LogLevel level, const char* module, const char* format, va_list args);
+  bool pop(LogRecord& record);
+
+  uint32_t written() const { return written_.load(std::memory_order_relaxed); }
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  static char levelChar(LogLevel level);
+
+private:
+  static const uint32_t MASK = LOG_RING_SIZE - 1;
+  static_assert(LOG_RING_SIZE >= 2 && (LOG_RING_SIZE & MASK) == 0, "LOG_RING_SIZE must be a power of two");
+
+  struct Cell {
+    std::atomic<uint32_t> sequence;
+    LogRecord record;
+  };
+
+  ClockFn clock_;
+  Cell cells_[LOG_RING_SIZE];
+  std::atomic<uint32_t> enqueuePos_{0};
+  std::atomic<uint32_t> dequeuePos_{0};
+  std::atomic<uint32_t> written_{0};
+  std::atomic<uint32_t> dropped_{0};
+};
+
+// The application defines the one ring the macros write to
+extern LogRing logRing;
+
+// ===== Logging macros =====
+// Each module gets a compile-time threshold, LOG_<module>_LEVEL, defined
+// by the application. Lines above it are constant-false branches, so the
+// call and its format string drop out of the build.
+#define LOG_AT(module, level, ...) \
+  do { \
+    if ((level) <= LOG_##module##_LEVEL) logRing.write((level), #module, __VA_ARGS__); \
+  } while (0)
+
+#define LOG_ERROR(module, ...) LOG_AT(module, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(module, ...) LOG_AT(module, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(module, ...) LOG_AT(module, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(module, ...) LOG_AT(module, LOG_LEVEL_DEBUG, __VA_ARGS__)
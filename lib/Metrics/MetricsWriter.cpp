@@ -0,0 +1,96 @@
+#include "MetricsWriter.h"
+
+const char* const MetricsWriter::CONTENT_TYPE = "text/plain; version=0.0.4";
+
+MetricsWriter::MetricsWriter(char* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {
+  if (capacity_ > 0) buffer_[0] = '\0';
+  else overflow_ = true;
+}
+
+MetricsWriter& MetricsWriter::counter(const char* name, const char* help, uint64_t value,
+                                      uint8_t decimals) {
+  metric(name, help, "counter", value, decimals);
+  return *this;
+}
+
+MetricsWriter& MetricsWriter::gauge(const char* name, const char* help, uint64_t value,
+                                    uint8_t decimals) {
+  metric(name, help, "gauge", value, decimals);
+  return *this;
+}
+
+MetricsWriter& MetricsWriter::histogram(const char* name, const char* help, const uint32_t* bounds,
+                                        const uint32_t* counts, int buckets, uint64_t sum,
+                                        uint8_t decimals) {
+  header(name, help, "histogram");
+  uint64_t cumulative = 0;
+  for (int i = 0; i < buckets; i++) {
+    cumulative += counts[i];
+    put(name);
+    put("_bucket{le=\"");
+    if (i < buckets - 1) putFixed(bounds[i], decimals);
+    else put("+Inf");
+    put("\"} ");
+    putFixed(cumulative, 0);
+    put('\n');
+  }
+  put(name);
+  put("_sum ");
+  putFixed(sum, decimals);
+  put('\n');
+  put(name);
+  put("_count ");
+  putFixed(cumulative, 0);
+  put('\n');
+  return *this;
+}
+
+// # HELP and # TYPE lines
+void MetricsWriter::header(const char* name, const char* help, const char* type) {
+  put("# HELP ");
+  put(name);
+  put(' ');
+  put(help);
+  put("\n# TYPE ");
+  put(name);
+  put(' ');
+  put(type);
+  put('\n');
+}
+
+void MetricsWriter::metric(const char* name, const char* help, const char* type, uint64_t value,
+                           uint8_t decimals) {
+  header(name, help, type);
+  put(name);
+  put(' ');
+  putFixed(value, decimals);
+  put('\n');
+}
+
+void MetricsWriter::put(char c) {
+  // Keep one byte for the terminator
+  if (length_ + 1 >= capacity_) {
+    overflow_ = true;
+    return;
+  }
+  buffer_[length_++] = c;
+  buffer_[length_] = '\0';
+}
+
+void MetricsWriter::put(const char* text) {
+  while (*text) put(*text++);
+}
+
+void MetricsWriter::putFixed(uint64_t value, uint8_t decimals) {
+  char digits[24];
+  if (decimals > 19) decimals = 19;
+  int n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value || n <= decimals);  // At least one digit before the point
+  while (n) {
+    if (n == decimals) put('.');
+    put(digits[--n]);
+  }
+}
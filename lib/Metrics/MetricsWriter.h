@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Prometheus text writer =====
+// Writes metrics in the Prometheus text exposition format straight into a
+// caller-owned buffer, like JsonWriter: no heap, no float printf. Values
+// are unsigned fixed point; `decimals` says how many of their digits
+// follow the point, so a duration held in ms is written as seconds with
+// gauge(name, help, ms, 3). If the buffer fills up, overflowed() turns
+// true and the output should not be sent.
+class MetricsWriter {
+public:
+  MetricsWriter(char* buffer, size_t capacity);
+
+  MetricsWriter& counter(const char* name, const char* help, uint64_t value, uint8_t decimals = 0);
+  MetricsWriter& gauge(const char* name, const char* help, uint64_t value, uint8_t decimals = 0);
+  // counts[i] holds the values <= bounds[i] (and above the bound before
+  // it); counts[buckets - 1] the rest. Written cumulatively as name_bucket
+  // lines plus name_sum and name_count.
+  MetricsWriter& histogram(const char* name, const char* help, const uint32_t* bounds,
+                           const uint32_t* counts, int buckets, uint64_t sum, uint8_t decimals = 0);
+
+  const char* c_str() const { return buffer_; }
+  size_t length() const { return length_; }
+  bool overflowed() const { return overflow_; }
+
+  // Content-Type for a scrape response
+  static const char* const CONTENT_TYPE;
+
+private:
+  void metric(const char* name, const char* help, const char* type, uint64_t value, uint8_t decimals);
+  void header(const char* name, const char* help, const char* type);
+  void put(char c);
+  void put(const char* text);
+  void putFixed(uint64_t value, uint8_t decimals);
+
+  char* buffer_;
+  size_t capacity_;
+  size_t length_ = 0;
+  bool overflow_ = false;
+};
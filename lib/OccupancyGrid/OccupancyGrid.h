@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Occupancy model =====
+// Log-odds in 1/16 nat steps, so a cell is one int8_t: 0 is unknown, +127
+// about 99.96% occupied, -127 as sure it is free.
+struct OccupancyConfig {
+  int8_t hit;              // Added to the cell the echo came from
+  int8_t miss;             // Added to cells the ping saw through
+  uint32_t decayPeriodMs;  // Every period each cell loses 1/2^decayShift
+  uint8_t decayShift;      // of its value, at least one step, toward 0
+};
+
+const uint8_t OCCUPANCY_VERSION = 1;
+const size_t OCCUPANCY_HEADER_SIZE = 12;
+
+// ===== Polar occupancy grid =====
+// What the radar has seen, kept across sweeps: one row per scan-step angle
+// bin (as in ScanFrame), CELL_CM range cells per row. Each reading marks
+// the cells in front of the echo as free and the echo's cell as occupied.
+// Cells nobody looks at drift back to unknown, so a walked-away object
+// fades instead of staying forever. Memory is ANGLE_BINS x RANGE_BINS
+// bytes, fixed at compile time.
+//
+// One writer (the sensor task). Cells are single bytes, so readers always
+// see whole cells, though a copy taken during an update can mix it with
+// the one before.
+template <int STEP_DEG, int RANGE_BINS, int CELL_CM>
+class OccupancyGrid {
+public:
+  static const int ANGLE_BINS = 180 / STEP_DEG + 1;
+  static const int CELLS = ANGLE_BINS * RANGE_BINS;
+  static const size_t BLOB_SIZE = OCCUPANCY_HEADER_SIZE + CELLS;
+
+  explicit OccupancyGrid(const OccupancyConfig& config) : config_(config) {}
+
+  // A reading at angle: distanceCm to the echo, listenedCm as far as the
+  // ping could have heard one. Distances at or past listenedCm mean
+  // nothing was there.
+  void update(int angle, float distanceCm, float listenedCm, uint32_t nowMs) {
+    decay(nowMs);
+
+    volatile int8_t* row = &cells_[angleBin(angle) * RANGE_BINS];
+    bool echo = distanceCm < listenedCm;
+    float freeCm = echo ? distanceCm : listenedCm;
+    int hitCell = echo ? (int)(distanceCm / CELL_CM) : RANGE_BINS;
+
+    // Free up to the cell the echo came from; a cell only partly in front
+    // of the echo is left to the hit
+    for (int cell = 0; cell < RANGE_BINS && cell < hitCell && (cell + 1) * CELL_CM <= freeCm; cell++) {
+      row[cell] = add(row[cell], config_.miss);
+    }
+    if (hitCell < RANGE_BINS) row[hitCell] = add(row[hitCell], config_.hit);
+  }
+
+  int8_t cell(int angleBin, int rangeBin) const { return cells_[angleBin * RANGE_BINS + rangeBin]; }
+
+  static int angleBin(int angle) {
+    if (angle < 0) return 0;
+    if (angle > 180) return ANGLE_BINS - 1;
+    return (angle + STEP_DEG / 2) / STEP_DEG;
+  }
+
+  // Header then cells, angle-major:
+  //   u8 version, u8 angle bins, u8 range bins, u8 step deg, u16 cell cm,
+  //   u16 reserved (0), u32 time of the last update in ms (little-endian)
+  //   ANGLE_BINS x RANGE_BINS int8 log-odds, row 0 at 0 degrees
+  // Returns the length, or 0 if size is less than BLOB_SIZE.
+  size_t writeBlob(uint8_t* buf, size_t size) const {
+    if (size < BLOB_SIZE) return 0;
+    uint32_t timeMs = lastUpdateMs_;
+    const uint8_t header[OCCUPANCY_HEADER_SIZE] = {
+      OCCUPANCY_VERSION, (uint8_t)ANGLE_BINS, (uint8_t)RANGE_BINS, (uint8_t)STEP_DEG,
+      (uint8_t)CELL_CM, (uint8_t)(CELL_CM >> 8), 0, 0,
+      (uint8_t)timeMs, (uint8_t)(timeMs >> 8), (uint8_t)(timeMs >> 16), (uint8_t)(timeMs >> 24),
+    };
+    for (size_t i = 0; i < OCCUPANCY_HEADER_SIZE; i++) buf[i] = header[i];
+    for (int i = 0; i < CELLS; i++) buf[OCCUPANCY_HEADER_SIZE + i] = (uint8_t)cells_[i];
+    return BLOB_SIZE;
+  }
+
+private:
+  static_assert(ANGLE_BINS < 256 && RANGE_BINS < 256, "bin counts go out as one byte each");
+
+  static int8_t add(int8_t value, int8_t delta) {
+    int sum = value + delta;
+    if (sum > 127) return 127;
+    if (sum < -127) return -127;
+    return sum;
+  }
+
+  // Whole periods since the last decay, one pass per period. Every pass
+  // moves a cell at least one step, so after 127 all are unknown.
+  void decay(uint32_t nowMs) {
+    if (!started_) {
+      started_ = true;
+      decayedMs_ = nowMs;
+    }
+    lastUpdateMs_ = nowMs;
+    if (config_.decayPeriodMs == 0) return;
+
+    uint32_t periods = (nowMs - decayedMs_) / config_.decayPeriodMs;
+    decayedMs_ += periods * config_.decayPeriodMs;
+    if (periods >= 127) {
+      for (int i = 0; i < CELLS; i++) cells_[i] = 0;
+      return;
+    }
+    for (uint32_t p = 0; p < periods; p++) {
+      for (int i = 0; i < CELLS; i++) {
+        int value = cells_[i];
+        if (value == 0) continue;
+        int step = value > 0 ? value >> config_.decayShift : -(-value >> config_.decayShift);
+        if (step == 0) step = value > 0 ? 1 : -1;
+        cells_[i] = value - step;
+      }
+    }
+  }
+
+  OccupancyConfig config_;
+  volatile int8_t cells_[CELLS] = {};
+  uint32_t lastUpdateMs_ = 0;
+  uint32_t decayedMs_ = 0;
+  bool started_ = false;
+};
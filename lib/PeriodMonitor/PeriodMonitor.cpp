@@ -0,0 +1,28 @@
+#include "PeriodMonitor.h"
+
+// Quarters of the limit
+static const uint8_t BOUND_QUARTERS[PeriodMonitor::BUCKETS - 1] = { 2, 3, 4, 5, 6, 8 };
+
+PeriodMonitor::PeriodMonitor(uint32_t limitMs) : limitMs_(limitMs) {
+  for (int i = 0; i < BUCKETS - 1; i++) bounds_[i] = limitMs * BOUND_QUARTERS[i] / 4;
+}
+
+void PeriodMonitor::mark(uint32_t nowMs) {
+  if (started_) record(nowMs - lastMarkMs_);
+  started_ = true;
+  lastMarkMs_ = nowMs;
+}
+
+void PeriodMonitor::record(uint32_t periodMs) {
+  int bucket = 0;
+  while (bucket < BUCKETS - 1 && periodMs > bounds_[bucket]) bucket++;
+  buckets_[bucket] = buckets_[bucket] + 1;
+
+  periods_ = periods_ + 1;
+  totalMs_ = totalMs_ + periodMs;
+  lastMs_ = periodMs;
+  if (periodMs > worstMs_) worstMs_ = periodMs;
+
+  violated_ = periodMs > limitMs_;
+  if (violated_) violations_ = violations_ + 1;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Period SLA monitor =====
+// Checks the time between successive events (readings, sweeps) against a
+// limit. Every period lands in a fixed histogram whose bounds are
+// fractions of the limit; a period over the limit counts as a violation
+// and sets violated() until a period within the limit comes in.
+//
+// One task feeds it; counters are single words so other tasks can read
+// them at any time.
+class PeriodMonitor {
+public:
+  // Upper bounds at 1/2, 3/4, 1, 5/4, 3/2 and 2x the limit, then +Inf
+  static const int BUCKETS = 7;
+
+  explicit PeriodMonitor(uint32_t limitMs);
+
+  // Time of each event; the first one only starts the clock
+  void mark(uint32_t nowMs);
+  void record(uint32_t periodMs);
+
+  uint32_t limitMs() const { return limitMs_; }
+  bool violated() const { return violated_; }
+  uint32_t periods() const { return periods_; }
+  uint32_t violations() const { return violations_; }
+  uint32_t lastMs() const { return lastMs_; }
+  uint32_t worstMs() const { return worstMs_; }
+  uint32_t totalMs() const { return totalMs_; }  // Wraps after ~49 days
+
+  // Bucket i counts periods <= bound(i) and above bound(i - 1); the last
+  // bucket has no bound
+  uint32_t boundMs(int bucket) const { return bounds_[bucket]; }
+  uint32_t bucketCount(int bucket) const { return buckets_[bucket]; }
+
+private:
+  uint32_t limitMs_;
+  uint32_t bounds_[BUCKETS - 1];
+  volatile uint32_t buckets_[BUCKETS] = {};
+
+  bool started_ = false;
+  uint32_t lastMarkMs_ = 0;
+  volatile bool violated_ = false;
+  volatile uint32_t periods_ = 0;
+  volatile uint32_t violations_ = 0;
+  volatile uint32_t lastMs_ = 0;
+  volatile uint32_t worstMs_ = 0;
+  volatile uint32_t totalMs_ = 0;
+};
@@ -0,0 +1,149 @@
+#include "Profiler.h"
+
+#include <stdio.h>
+
+#if PROFILING
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+uint32_t profileTicks() {
+  return ESP.getCycleCount();
+}
+
+uint32_t profileTicksPerUs() {
+  return getCpuFrequencyMhz();
+}
+#else
+#include <chrono>
+
+uint32_t (*profileClockUs)() = nullptr;
+
+uint32_t profileTicks() {
+  if (profileClockUs != nullptr) return profileClockUs();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t profileTicksPerUs() {
+  return profileClockUs != nullptr ? 1 : 1000;
+}
+#endif
+
+ProfileStage* ProfileStage::head_ = nullptr;
+
+// Stages are globals, so this runs during static initialisation. Appended
+// so reports list them in definition order (within a file).
+ProfileStage::ProfileStage(const char* name) : name_(name), id_(0), next_(nullptr) {
+  ProfileStage** link = &head_;
+  while (*link != nullptr) {
+    link = &(*link)->next_;
+    id_++;
+  }
+  *link = this;
+}
+
+void ProfileStage::record(uint32_t ticks) {
+  count_++;
+  total_ += ticks;
+  if (ticks < min_) min_ = ticks;
+  if (ticks > max_) max_ = ticks;
+  buckets_[bucketOf(ticks)]++;
+}
+
+void ProfileStage::reset() {
+  count_ = 0;
+  min_ = UINT32_MAX;
+  max_ = 0;
+  total_ = 0;
+  for (int i = 0; i < BUCKETS; i++) buckets_[i] = 0;
+}
+
+void ProfileStage::resetAll() {
+  for (ProfileStage* stage = head_; stage != nullptr; stage = stage->next_) stage->reset();
+}
+
+// Values below SUB_BUCKETS get a bucket each; above that, each power of
+// two is split into SUB_BUCKETS equal parts
+int ProfileStage::bucketOf(uint32_t ticks) {
+  if (ticks < SUB_BUCKETS) return ticks;
+  int octave = 31 - __builtin_clz(ticks);  // >= 2
+  int sub = (ticks >> (octave - 2)) & (SUB_BUCKETS - 1);
+  return (octave - 1) * SUB_BUCKETS + sub;
+}
+
+uint32_t ProfileStage::bucketLow(int bucket) {
+  if (bucket < SUB_BUCKETS) return bucket;
+  int octave = bucket / SUB_BUCKETS + 1;
+  return (uint32_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << (octave - 2);
+}
+
+uint32_t ProfileStage::bucketWidth(int bucket) {
+  return bucket < SUB_BUCKETS ? 1 : 1u << (bucket / SUB_BUCKETS - 1);
+}
+
+// Samples are taken as spread evenly across their bucket
+uint32_t ProfileStage::percentile(uint32_t rank) const {
+  uint32_t seen = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    if (buckets_[i] == 0) continue;
+    if (seen + buckets_[i] >= rank) {
+      uint64_t offset = (uint64_t)bucketWidth(i) * (2 * (rank - seen) - 1) / (2 * buckets_[i]);
+      uint32_t value = bucketLow(i) + (uint32_t)offset;
+      // The estimate can lie outside what was actually seen
+      if (value < min_) return min_;
+      if (value > max_) return max_;
+      return value;
+    }
+    seen += buckets_[i];
+  }
+  return max_;
+}
+
+ProfileSummary ProfileStage::summary() const {
+  ProfileSummary s = { count_, count_ ? min_ : 0, max_, total_, 0, 0 };
+  if (count_ == 0) return s;
+  s.p50Ticks = percentile((count_ + 1) / 2);
+  s.p99Ticks = percentile(count_ - count_ / 100);
+  return s;
+}
+
+// Ticks as microseconds with one decimal, into a fixed-width column
+static int formatUs(char* buf, size_t size, uint64_t ticks) {
+  uint64_t tenths = ticks * 10 / profileTicksPerUs();
+  return snprintf(buf, size, " %9lu.%lu", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+}
+
+size_t profileReport(char* buf, size_t size) {
+  if (size == 0) return 0;
+  size_t len = 0;
+  int n = snprintf(buf, size, "%-16s %8s %11s %11s %11s %11s %11s  (us)\n", "stage", "count",
+                   "min", "avg", "p50", "p99", "max");
+  if (n > 0) len = (size_t)n < size ? n : size - 1;
+
+  for (const ProfileStage* stage = ProfileStage::first(); stage != nullptr; stage = stage->next()) {
+    ProfileSummary s = stage->summary();
+    char line[128];
+    int at = snprintf(line, sizeof(line), "%-16s %8lu", stage->name(), (unsigned long)s.count);
+    at += formatUs(line + at, sizeof(line) - at, s.minTicks);
+    at += formatUs(line + at, sizeof(line) - at, s.count ? s.totalTicks / s.count : 0);
+    at += formatUs(line + at, sizeof(line) - at, s.p50Ticks);
+    at += formatUs(line + at, sizeof(line) - at, s.p99Ticks);
+    at += formatUs(line + at, sizeof(line) - at, s.maxTicks);
+    n = snprintf(buf + len, size - len, "%s\n", line);
+    if (n < 0 || (size_t)n >= size - len) {
+      buf[len] = '\0';  // Out of room; keep whole lines only
+      break;
+    }
+    len += n;
+  }
+  return len;
+}
+
+#else
+
+size_t profileReport(char* buf, size_t size) {
+  return size ? snprintf(buf, size, "Profiling compiled out (PROFILING=0)\n") : 0;
+}
+
+#endif
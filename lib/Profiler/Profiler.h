@@ -0,0 +1,167 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Trace.h"
+
+// ===== Stage profiler =====
+// Scoped timers that feed fixed-size histograms, one per named stage.
+// Time comes from the CPU cycle counter on the ESP32 and steady_clock
+// (ns) on the host; a record is a counter read, a count-leading-zeros and
+// a few adds. profileReport() renders count, min, avg, p50, p99 and max
+// in microseconds. A single span must stay under 2^32 ticks: 17 s at
+// 240 MHz, 4.2 s on the host.
+//
+// A stage must be recorded from one task only (on the ESP32 the cycle
+// counter is per core and every task here is pinned). Reports and resets
+// may come from any task; a report taken mid-record can be off by one
+// sample.
+//
+// Scope and span edges also go to the trace ring (Trace.h) unless built
+// with -DTRACING=0. Build with -DPROFILING=0 to compile both out: stages
+// become empty objects and every call an empty inline function.
+#ifndef PROFILING
+#define PROFILING 1
+#endif
+#if !PROFILING
+#undef TRACING
+#define TRACING 0
+#elif !defined(TRACING)
+#define TRACING 1
+#endif
+
+struct ProfileSummary {
+  uint32_t count;
+  uint32_t minTicks;
+  uint32_t maxTicks;
+  uint64_t totalTicks;
+  uint32_t p50Ticks;
+  uint32_t p99Ticks;
+};
+
+#if PROFILING
+
+uint32_t profileTicks();
+uint32_t profileTicksPerUs();
+
+#ifndef ARDUINO
+// Host only: when set, stages and trace events are timed in microseconds
+// of this clock instead of steady_clock. A VirtualClock (--fast) gives
+// waits their simulated length; CPU work between clock steps reads 0.
+extern uint32_t (*profileClockUs)();
+#endif
+
+#if TRACING
+void traceEvent(uint16_t stage, TracePhase phase);
+#else
+inline void traceEvent(uint16_t, TracePhase) {}
+#endif
+
+class ProfileStage {
+public:
+  // Four buckets per power of two up to 2^32 ticks; percentiles are
+  // interpolated within a bucket
+  static const int SUB_BUCKETS = 4;
+  static const int BUCKETS = (32 - 1) * SUB_BUCKETS;
+
+  explicit ProfileStage(const char* name);
+
+  void record(uint32_t ticks);
+  void reset();
+  ProfileSummary summary() const;
+
+  const char* name() const { return name_; }
+  uint16_t id() const { return id_; }  // Definition order, from 0
+  const ProfileStage* next() const { return next_; }
+  static const ProfileStage* first() { return head_; }
+  static void resetAll();
+
+private:
+  static int bucketOf(uint32_t ticks);
+  static uint32_t bucketLow(int bucket);
+  static uint32_t bucketWidth(int bucket);
+  uint32_t percentile(uint32_t rank) const;
+
+  const char* name_;
+  uint16_t id_;
+  ProfileStage* next_;
+  static ProfileStage* head_;
+
+  uint32_t count_ = 0;
+  uint32_t min_ = UINT32_MAX;
+  uint32_t max_ = 0;
+  uint64_t total_ = 0;
+  uint32_t buckets_[BUCKETS] = {};
+};
+
+// Times its own lifetime
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileStage& stage) : stage_(stage) {
+    traceEvent(stage_.id(), TRACE_BEGIN);
+    start_ = profileTicks();
+  }
+  ~ProfileScope() {
+    stage_.record(profileTicks() - start_);
+    traceEvent(stage_.id(), TRACE_END);
+  }
+
+private:
+  ProfileStage& stage_;
+  uint32_t start_;
+};
+
+// For stages that span several calls, e.g. a wait between two polls
+class ProfileSpan {
+public:
+  explicit ProfileSpan(ProfileStage& stage) : stage_(stage) {}
+  void begin() {
+    traceEvent(stage_.id(), TRACE_BEGIN);
+    start_ = profileTicks();
+  }
+  void end() {
+    stage_.record(profileTicks() - start_);
+    traceEvent(stage_.id(), TRACE_END);
+  }
+
+private:
+  ProfileStage& stage_;
+  uint32_t start_ = 0;
+};
+
+#else
+
+inline uint32_t profileTicks() { return 0; }
+inline uint32_t profileTicksPerUs() { return 1; }
+
+class ProfileStage {
+public:
+  explicit ProfileStage(const char*) {}
+  void record(uint32_t) {}
+  void reset() {}
+  static void resetAll() {}
+};
+
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileStage&) {}
+};
+
+class ProfileSpan {
+public:
+  explicit ProfileSpan(ProfileStage&) {}
+  void begin() {}
+  void end() {}
+};
+
+#endif
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// Times the rest of the enclosing block
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(stage)
+
+// Plain-text table of every stage into buf; returns the length written
+// (always terminated, cut short if buf is too small)
+size_t profileReport(char* buf, size_t size);
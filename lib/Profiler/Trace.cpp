@@ -0,0 +1,146 @@
+#include "Trace.h"
+
+#include <atomic>
+
+#include "Profiler.h"
+
+#if TRACING
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+uint32_t traceMicros() {
+  return micros();
+}
+
+static uint8_t traceCore() {
+  return xPortGetCoreID();
+}
+#else
+#include <chrono>
+
+uint32_t traceMicros() {
+  if (profileClockUs != nullptr) return profileClockUs();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint8_t traceCore() {
+  return 0;
+}
+#endif
+
+// A slot's sequence is its event number + 1 once written and 0 while a
+// writer is filling it, so a reader can tell a finished event from one
+// that is being overwritten under it. The payload words are relaxed
+// atomics, which compile to plain loads and stores.
+struct TraceSlot {
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> timeUs;
+  std::atomic<uint32_t> event;  // Stage id | phase << 16 | core << 24
+};
+
+struct TraceRecord {
+  uint32_t timeUs;
+  uint32_t event;
+};
+
+static TraceSlot traceSlots[TRACE_EVENTS];
+static std::atomic<uint32_t> traceHead{0};
+
+void traceEvent(uint16_t stage, TracePhase phase) {
+  // Stamp before claiming the slot so the time is the scope edge itself; a
+  // writer preempted in between only lands slightly out of order in the
+  // ring, which the converter sorts out
+  uint32_t timeUs = traceMicros();
+  uint32_t n = traceHead.fetch_add(1, std::memory_order_relaxed);
+  TraceSlot& slot = traceSlots[n % TRACE_EVENTS];
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timeUs.store(timeUs, std::memory_order_relaxed);
+  slot.event.store(stage | (uint32_t)phase << 16 | (uint32_t)traceCore() << 24,
+                   std::memory_order_relaxed);
+  slot.sequence.store(n + 1, std::memory_order_release);
+}
+
+// Copies event n if it is still in the ring and was not touched meanwhile
+static bool readSlot(uint32_t n, TraceRecord& out) {
+  const TraceSlot& slot = traceSlots[n % TRACE_EVENTS];
+  if (slot.sequence.load(std::memory_order_acquire) != n + 1) return false;
+  out.timeUs = slot.timeUs.load(std::memory_order_relaxed);
+  out.event = slot.event.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == n + 1;
+}
+
+#endif
+
+static uint8_t* put16(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+  return p + 4;
+}
+
+static void putHeader(uint8_t* p, uint16_t stages, uint32_t events, uint32_t nowUs) {
+  for (char c : TRACE_MAGIC) *p++ = c;
+  p = put16(p, TRACE_VERSION);
+  p = put16(p, stages);
+  p = put32(p, events);
+  put32(p, nowUs);
+}
+
+#if PROFILING
+
+size_t traceDump(uint8_t* buf, size_t size) {
+  if (size < TRACE_HEADER_SIZE) return 0;
+  uint8_t* p = buf + TRACE_HEADER_SIZE;
+  uint8_t* end = buf + size;
+
+  uint16_t stages = 0;
+  for (const ProfileStage* stage = ProfileStage::first(); stage != nullptr; stage = stage->next()) {
+    size_t len = 0;
+    while (stage->name()[len] != '\0' && len < 255) len++;
+    if ((size_t)(end - p) < len + 1) return 0;
+    *p++ = len;
+    for (size_t i = 0; i < len; i++) *p++ = stage->name()[i];
+    stages++;
+  }
+
+  uint32_t events = 0;
+  uint32_t nowUs = 0;
+#if TRACING
+  uint32_t head = traceHead.load(std::memory_order_acquire);
+  uint32_t room = (end - p) / TRACE_EVENT_SIZE;
+  uint32_t count = head < TRACE_EVENTS ? head : TRACE_EVENTS;
+  if (count > room) count = room;
+  for (uint32_t n = head - count; n != head; n++) {
+    TraceRecord record;
+    if (!readSlot(n, record)) continue;  // Overwritten or still being written
+    p = put32(p, record.timeUs);
+    p = put32(p, record.event);  // Same bytes as u16 stage, u8 phase, u8 core
+    events++;
+  }
+  nowUs = traceMicros();
+#endif
+
+  putHeader(buf, stages, events, nowUs);
+  return p - buf;
+}
+
+#else
+
+size_t traceDump(uint8_t* buf, size_t size) {
+  if (size < TRACE_HEADER_SIZE) return 0;
+  putHeader(buf, 0, 0, 0);
+  return TRACE_HEADER_SIZE;
+}
+
+#endif
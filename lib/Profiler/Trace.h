@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Stage trace =====
+// A flight recorder of begin/end events for the profiler's stages: every
+// ProfileScope and ProfileSpan also lands here, with a microsecond
+// timestamp (micros() on the ESP32, so cores agree; steady_clock on the
+// host) and the core it ran on. The ring keeps the newest TRACE_EVENTS
+// events; any task may record, readers never block writers.
+//
+// traceDump() writes the binary format below; tools/trace_to_chrome turns
+// it into Chrome trace / Perfetto JSON with one row per task, taken from
+// the stage name prefix ("scan.settle" -> "scan").
+//
+// Tracing follows PROFILING; -DTRACING=0 keeps the profiler without it
+// (see Profiler.h).
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 320  // A whole dump fits one HTTP response body
+#endif
+
+// Dump layout, little-endian:
+//   "RTRC", u16 version, u16 stage count, u32 event count, u32 dump time us
+//   per stage, in id order: u8 name length, name bytes
+//   per event, oldest first: u32 time us, u16 stage id, u8 phase, u8 core
+const char TRACE_MAGIC[4] = { 'R', 'T', 'R', 'C' };
+const uint16_t TRACE_VERSION = 1;
+const size_t TRACE_HEADER_SIZE = 16;
+const size_t TRACE_EVENT_SIZE = 8;
+
+enum TracePhase : uint8_t {
+  TRACE_BEGIN = 'B',
+  TRACE_END = 'E',
+};
+
+// Newest events that fit into buf, with the stage names; returns the
+// length written (0 if not even the names fit)
+size_t traceDump(uint8_t* buf, size_t size);
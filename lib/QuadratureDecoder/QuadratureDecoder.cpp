@@ -0,0 +1,39 @@
+#include "QuadratureDecoder.h"
+
+// Indexed by (from << 2) | to over (clk << 1) | dt states.
+// Clockwise runs 00 -> 10 -> 11 -> 01 -> 00.
+static const int8_t TRANSITIONS[16] = {
+  //  to: 00  01  10  11
+  0, -1, +1,  0,  // from 00
+  +1, 0,  0, -1,  // from 01
+  -1, 0,  0, +1,  // from 10
+  0, +1, -1,  0,  // from 11
+};
+
+int8_t QuadratureDecoder::step(uint8_t from, uint8_t to) {
+  return TRANSITIONS[(from << 2) | to];
+}
+
+void QuadratureDecoder::reset(bool clk, bool dt) {
+  state_ = pending_ = (clk << 1) | dt;
+  count_ = 0;
+  invalid_ = 0;
+}
+
+int QuadratureDecoder::feed(bool clk, bool dt, uint32_t timestampUs) {
+  uint8_t levels = (clk << 1) | dt;
+
+  // Like the PCNT filter, a level only counts once it has been stable for
+  // filterUs; shorter pulses are dropped.
+  if (levels != pending_) {
+    pending_ = levels;
+    pendingSince_ = timestampUs;
+  }
+  if (pending_ == state_ || timestampUs - pendingSince_ < filterUs_) return 0;
+
+  int8_t delta = step(state_, pending_);
+  if (delta == 0) invalid_++;  // Missed an edge; resync without counting
+  state_ = pending_;
+  count_ += delta;
+  return delta;
+}
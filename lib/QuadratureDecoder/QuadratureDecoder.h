@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Quadrature decoder model =====
+// Software model of how the ESP32 pulse counter is configured to decode
+// the range encoder: x4 decoding on both CLK and DT edges plus the
+// peripheral's glitch filter. On the device the PCNT does this in
+// hardware; this class lets the same behaviour be checked on a host by
+// feeding it sampled CLK/DT levels.
+//
+// Clockwise (CLK leading DT) counts up. Contact bounce on one line shows
+// up as +1/-1 pairs that cancel, so no software debounce is needed.
+class QuadratureDecoder {
+public:
+  static const int COUNTS_PER_DETENT = 4;  // One full quadrature cycle per click
+
+  explicit QuadratureDecoder(uint32_t glitchFilterUs = 0) : filterUs_(glitchFilterUs) {}
+
+  void reset(bool clk, bool dt);
+  // Line levels observed at timestampUs; returns the count change (-1, 0, +1)
+  int feed(bool clk, bool dt, uint32_t timestampUs);
+
+  int32_t count() const { return count_; }
+  int32_t detents() const { return countsToDetents(count_); }
+  uint32_t invalidTransitions() const { return invalid_; }  // Both lines changed at once
+
+  // Nearest detent: rest positions sit on multiples of COUNTS_PER_DETENT,
+  // so the boundaries fall halfway between clicks and a bounce or nudge
+  // either way reads as no change. Floor division, so a click is the same
+  // size on both sides of zero.
+  static int32_t countsToDetents(int32_t counts) {
+    int32_t shifted = counts + COUNTS_PER_DETENT / 2;
+    return shifted >= 0 ? shifted / COUNTS_PER_DETENT : -((-shifted + COUNTS_PER_DETENT - 1) / COUNTS_PER_DETENT);
+  }
+
+private:
+  static int8_t step(uint8_t from, uint8_t to);
+
+  uint32_t filterUs_;
+  uint8_t state_ = 0;          // Accepted (clk << 1) | dt
+  uint8_t pending_ = 0;        // Levels waiting out the filter
+  uint32_t pendingSince_ = 0;
+  int32_t count_ = 0;
+  uint32_t invalid_ = 0;
+};
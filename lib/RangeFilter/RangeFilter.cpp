@@ -0,0 +1,92 @@
+#include "RangeFilter.h"
+
+#include <math.h>
+
+RangeFilter::RangeFilter(const RangeFilterConfig& config) : config_(config) {
+  if (config_.maxPings > MAX_PINGS) config_.maxPings = MAX_PINGS;
+  if (config_.maxPings < 1) config_.maxPings = 1;
+  if (config_.minPings < 1) config_.minPings = 1;
+  if (config_.minPings > config_.maxPings) config_.minPings = config_.maxPings;
+}
+
+bool RangeFilter::add(float cm) {
+  if (count_ < config_.maxPings) pings_[count_++] = cm;
+  return done();
+}
+
+bool RangeFilter::done() const {
+  if (count_ >= config_.maxPings) return true;
+  if (count_ < config_.minPings || count_ < 2) return false;
+
+  // Majority agreement around the median
+  float values[MAX_PINGS];
+  sorted(values);
+  float median = values[count_ / 2];
+  float window = tolerance(median);
+  int agreeing = 0;
+  for (int i = 0; i < count_; i++) {
+    if (fabsf(values[i] - median) <= window) agreeing++;
+  }
+  return agreeing > count_ / 2;
+}
+
+float RangeFilter::result() const {
+  if (count_ == 0) return 0;
+
+  float values[MAX_PINGS];
+  sorted(values);
+  float median = count_ % 2 ? values[count_ / 2] : (values[count_ / 2 - 1] + values[count_ / 2]) / 2;
+
+  switch (config_.mode) {
+    case FILTER_TRIMMED_MEAN: {
+      int trim = (int)(count_ * config_.trimFraction);
+      if (trim == 0 && count_ >= 3) trim = 1;
+      float sum = 0;
+      for (int i = trim; i < count_ - trim; i++) sum += values[i];
+      return sum / (count_ - 2 * trim);
+    }
+
+    case FILTER_HAMPEL: {
+      float deviations[MAX_PINGS];
+      for (int i = 0; i < count_; i++) deviations[i] = fabsf(values[i] - median);
+      // Insertion sort; count_ is tiny
+      for (int i = 1; i < count_; i++) {
+        float d = deviations[i];
+        int j = i - 1;
+        for (; j >= 0 && deviations[j] > d; j--) deviations[j + 1] = deviations[j];
+        deviations[j + 1] = d;
+      }
+      float mad = deviations[count_ / 2] * 1.4826f;
+      float limit = config_.hampelK * mad;
+      if (limit < tolerance(median)) limit = tolerance(median);
+
+      float sum = 0;
+      int inliers = 0;
+      for (int i = 0; i < count_; i++) {
+        if (fabsf(values[i] - median) <= limit) {
+          sum += values[i];
+          inliers++;
+        }
+      }
+      return inliers ? sum / inliers : median;
+    }
+
+    case FILTER_MEDIAN:
+    default:
+      return median;
+  }
+}
+
+float RangeFilter::tolerance(float cm) const {
+  float relative = cm * config_.toleranceFraction;
+  return relative > config_.toleranceCm ? relative : config_.toleranceCm;
+}
+
+void RangeFilter::sorted(float* out) const {
+  for (int i = 0; i < count_; i++) {
+    float v = pings_[i];
+    int j = i - 1;
+    for (; j >= 0 && out[j] > v; j--) out[j + 1] = out[j];
+    out[j + 1] = v;
+  }
+}
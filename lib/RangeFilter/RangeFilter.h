@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Range filter =====
+// Combines the pings of one reading into a distance. Readings are added
+// one ping at a time and the filter says when it has seen enough: two
+// pings that agree within tolerance end the reading early, and only
+// disagreeing pings pull in more, up to maxPings. Once more than two are
+// in, the reading ends as soon as a majority sits within tolerance of the
+// median.
+enum FilterMode : uint8_t {
+  FILTER_MEDIAN,        // Median of the pings taken
+  FILTER_TRIMMED_MEAN,  // Mean after dropping trimFraction from each end
+  FILTER_HAMPEL,        // Mean of the pings within hampelK scaled MADs of the median
+};
+
+struct RangeFilterConfig {
+  FilterMode mode;
+  uint8_t minPings;         // At least 1
+  uint8_t maxPings;         // At most RangeFilter::MAX_PINGS
+  float toleranceCm;        // Absolute agreement window
+  float toleranceFraction;  // Relative window, for far targets
+  float trimFraction;       // FILTER_TRIMMED_MEAN
+  float hampelK;            // FILTER_HAMPEL
+};
+
+class RangeFilter {
+public:
+  static const int MAX_PINGS = 9;
+
+  explicit RangeFilter(const RangeFilterConfig& config);
+
+  void reset() { count_ = 0; }
+  // Adds one ping; returns true once the reading is complete
+  bool add(float cm);
+  bool done() const;
+  float result() const;
+
+  int count() const { return count_; }
+  const RangeFilterConfig& config() const { return config_; }
+
+private:
+  float tolerance(float cm) const;
+  void sorted(float* out) const;
+
+  RangeFilterConfig config_;
+  float pings_[MAX_PINGS];
+  int count_ = 0;
+};
@@ -0,0 +1,167 @@
+#include "ScanController.h"
+
+// Settle and reading are wall time, from servo command to first ping and
+// from first ping to filtered result. Sample is the CPU time spent on a
+// finished reading, listeners included. poll() itself runs too often to
+// time every call.
+static ProfileStage settleStage("scan.settle");
+static ProfileStage readingStage("scan.reading");
+static ProfileStage sampleStage("scan.sample");
+
+ScanController::ScanController(const ScanConfig& config, const RangeFilterConfig& filter,
+                               const ServoMotionConfig& motion, HalClock& clock, HalServo& servo,
+                               EchoCapture& capture, ScanListener& listener)
+    : config_(config),
+      filter_(filter),
+      motion_(motion),
+      clock_(clock),
+      servo_(servo),
+      capture_(capture),
+      listener_(listener),
+      settleSpan_(settleStage),
+      readingSpan_(readingStage),
+      pingGuardUs_(config.pingGuardUs) {}
+
+uint32_t ScanController::poll() {
+  uint32_t now = clock_.millis();
+  if (!started_) {
+    started_ = true;
+    sweepStartMs_ = now;
+    echoAtSweepStart_ = capture_.stats();
+  }
+
+  // Each phase runs straight into the next when nothing is left to wait for
+  if (phase_ == MOVE) {
+    // Move the servo and wait only as long as this move needs
+    moveStartMs_ = now;
+    move_ = motion_.planMove(angle_);
+    servo_.write(angle_);
+    settleSpan_.begin();
+    settleUntilMs_ = now + move_.waitMs + holdMs_;
+    holdMs_ = 0;
+    phase_ = SETTLE;
+  }
+
+  if (phase_ == SETTLE) {
+    int32_t remaining = (int32_t)(settleUntilMs_ - now);
+    if (remaining > 0) return remaining;
+    settleSpan_.end();
+    readingSpan_.begin();
+    beginReading();
+    phase_ = MEASURE;
+  }
+
+  // Measure distance at this angle; the echo is timed in the background
+  float distance;
+  if (!pollReading(distance)) return 1;
+  readingSpan_.end();
+  finishReading(distance);
+  phase_ = MOVE;
+  return 0;
+}
+
+// A reading is a run of pings fed to the range filter until it is
+// satisfied; each ping is started here and completes in the background.
+void ScanController::beginReading() {
+  if (config_.rangeGating) {
+    // The echo timeout and the guard between pings both follow the active
+    // range: the guard lets a second bounce from inside the gate die out
+    // before the next ping starts listening.
+    uint32_t gateUs = roundTripUs(limit_ + config_.gateMarginCm);
+    uint32_t timeoutUs = config_.echoResponseUs + gateUs;
+    if (timeoutUs > EchoCapture::DEFAULT_TIMEOUT_US) timeoutUs = EchoCapture::DEFAULT_TIMEOUT_US;
+    capture_.setTimeoutUs(timeoutUs);
+    pingGuardUs_ = config_.pingGuardUs + gateUs;
+  }
+
+  filter_.reset();
+  readingPings_ = 0;
+  capture_.startPing(clock_.micros());
+}
+
+// Returns true once the reading is complete and stores the filtered distance
+bool ScanController::pollReading(float& distance) {
+  capture_.poll(clock_.micros());
+
+  // No echo counts as out of range, so missing pings agree with each other
+  EchoResult result;
+  bool complete = filter_.done();
+  while (!complete && capture_.nextResult(result)) {
+    float cm = result.timedOut ? 0 : EchoCapture::echoToCm(result.echoUs);
+    if (cm <= 0 || cm > config_.maxRangeCm) cm = config_.maxRangeCm;
+    complete = filter_.add(cm);
+    if (readingPings_ < RangeFilter::MAX_PINGS) {
+      readingEchoUs_[readingPings_++] = result.timedOut ? 0 : result.echoUs;
+    }
+    lastPingDoneUs_ = clock_.micros();
+  }
+
+  if (!complete) {
+    if (!capture_.busy() && clock_.micros() - lastPingDoneUs_ >= pingGuardUs_) {
+      capture_.startPing(clock_.micros());
+    }
+    return false;
+  }
+
+  distance = filter_.result();
+  return true;
+}
+
+void ScanController::finishReading(float distance) {
+  PROFILE_SCOPE(sampleStage);
+  uint32_t now = clock_.millis();
+  move_.elapsedMs = now - moveStartMs_;
+  sweepTiming_.settleMs += move_.waitMs;
+  sweepTiming_.moves++;
+  listener_.onMove(move_);
+
+  // Object detection logic
+  float limit = limit_;
+  detecting_ = distance <= limit;
+  RadarSample sample = { angle_, distance, limit, detecting_ };
+  readings_ = readings_ + 1;
+  listener_.onSample(sample, now);
+
+  if (detecting_) {
+    holdMs_ = config_.detectHoldMs;  // Hold this angle while the object is in range
+    return;
+  }
+  advance();
+}
+
+// Next angle (only runs when NO object detected). A sweep ends at each
+// end-stop reversal.
+void ScanController::advance() {
+  uint32_t sweepBefore = sweep_;
+
+  if (movingForward_) {
+    angle_ += config_.stepDeg;
+    if (angle_ >= 180) {
+      angle_ = 180;
+      movingForward_ = false;
+      sweep_ = sweep_ + 1;
+    }
+  } else {
+    angle_ -= config_.stepDeg;
+    if (angle_ <= 0) {
+      angle_ = 0;
+      movingForward_ = true;
+      sweep_ = sweep_ + 1;
+    }
+  }
+
+  if (sweep_ != sweepBefore) {
+    uint32_t now = clock_.millis();
+    EchoStats echo = capture_.stats();
+    sweepTiming_.sweep = sweepBefore;
+    sweepTiming_.durationMs = now - sweepStartMs_;
+    lastSweepMs_ = sweepTiming_.durationMs;
+    sweepTiming_.echo.pings = echo.pings - echoAtSweepStart_.pings;
+    sweepTiming_.echo.timeouts = echo.timeouts - echoAtSweepStart_.timeouts;
+    sweepTiming_.echo.gatedSavedUs = echo.gatedSavedUs - echoAtSweepStart_.gatedSavedUs;
+    listener_.onSweep(sweepTiming_);
+    sweepTiming_ = {};
+    sweepStartMs_ = now;
+    echoAtSweepStart_ = echo;
+  }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "EchoCapture.h"
+#include "Hal.h"
+#include "Profiler.h"
+#include "RangeFilter.h"
+#include "ServoMotion.h"
+
+// ===== Scan samples =====
+// One per reading
+struct RadarSample {
+  int angle;
+  float distance;
+  float range;
+  bool detecting;
+};
+
+// Sweep timing, reported at each end-stop reversal
+struct SweepTiming {
+  uint32_t sweep;
+  uint32_t durationMs;
+  uint32_t settleMs;  // Portion spent waiting for the servo
+  int moves;
+  EchoStats echo;     // Pings, timeouts and gate savings during the sweep
+};
+
+struct ScanConfig {
+  int stepDeg;
+  uint16_t detectHoldMs;    // Extra dwell while an object is in range
+  uint32_t pingGuardUs;     // Gap between pings of one reading
+  bool rangeGating;         // Stop listening just past the detection limit
+  float gateMarginCm;       // Listened past the limit when gating
+  uint32_t echoResponseUs;  // Trigger to echo-line rise
+  float maxRangeCm;         // Readings beyond this (or none) clamp to it
+};
+
+// Receives what the scan produces. Called from whichever context runs
+// ScanController::poll(), so implementations should only queue.
+class ScanListener {
+public:
+  virtual ~ScanListener() {}
+  virtual void onSample(const RadarSample& sample, uint32_t timeMs) = 0;
+  virtual void onMove(const MoveTiming& move) {}
+  virtual void onSweep(const SweepTiming& sweep) {}
+};
+
+// ===== Scan controller =====
+// The sweep and detection logic, free of any platform calls: move the
+// servo, wait for it to settle, take a filtered multi-ping reading, hold
+// while an object is inside the detection limit, otherwise step on and
+// reverse at the end stops.
+//
+// poll() never blocks. It does whatever is due and returns how many ms
+// may pass before it needs to run again; the caller sleeps that long (a
+// FreeRTOS task on the device, a plain loop on the host).
+class ScanController {
+public:
+  ScanController(const ScanConfig& config, const RangeFilterConfig& filter,
+                 const ServoMotionConfig& motion, HalClock& clock, HalServo& servo,
+                 EchoCapture& capture, ScanListener& listener);
+
+  uint32_t poll();
+
+  // May be called from another task; takes effect from the next reading
+  void setLimit(float cm) { limit_ = cm; }
+  float limit() const { return limit_; }
+
+  int angle() const { return angle_; }
+  bool detecting() const { return detecting_; }
+  uint32_t sweep() const { return sweep_; }
+  uint32_t readings() const { return readings_; }
+  uint32_t lastSweepMs() const { return lastSweepMs_; }  // 0 until a sweep completes
+
+  // Raw echo widths of the last reading (0 for a timed-out ping)
+  uint8_t readingPings() const { return readingPings_; }
+  uint32_t readingEchoUs(uint8_t ping) const { return readingEchoUs_[ping]; }
+
+private:
+  enum Phase { MOVE, SETTLE, MEASURE };
+
+  void beginReading();
+  bool pollReading(float& distance);
+  void finishReading(float distance);
+  void advance();
+  uint32_t roundTripUs(float cm) const { return (uint32_t)(cm * 2 / 0.0343f); }
+
+  ScanConfig config_;
+  RangeFilter filter_;
+  ServoMotion motion_;
+  HalClock& clock_;
+  HalServo& servo_;
+  EchoCapture& capture_;
+  ScanListener& listener_;
+
+  volatile float limit_ = 0;
+  int angle_ = 0;
+  bool movingForward_ = true;
+  volatile bool detecting_ = false;
+  volatile uint32_t sweep_ = 0;
+  volatile uint32_t readings_ = 0;
+  volatile uint32_t lastSweepMs_ = 0;
+
+  Phase phase_ = MOVE;
+  MoveTiming move_ = {};
+  uint32_t moveStartMs_ = 0;
+  uint32_t settleUntilMs_ = 0;
+  uint32_t holdMs_ = 0;
+  ProfileSpan settleSpan_;
+  ProfileSpan readingSpan_;
+
+  uint32_t lastPingDoneUs_ = 0;
+  uint32_t pingGuardUs_;
+  uint32_t readingEchoUs_[RangeFilter::MAX_PINGS];
+  uint8_t readingPings_ = 0;
+
+  SweepTiming sweepTiming_ = {};
+  uint32_t sweepStartMs_ = 0;
+  EchoStats echoAtSweepStart_ = {};
+  bool started_ = false;
+};
@@ -0,0 +1,52 @@
+#include "ScanTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+const char TRACE_HEADER[] = "seq,reading,time_ms,angle_deg,distance_cm,range_cm,detecting,pings,echo_us";
+
+bool parseTraceRow(const char* line, TraceReading& out) {
+  unsigned seq, reading, timeMs, pings;
+  int angle, detecting, used = 0;
+  float distance, range;
+  if (sscanf(line, "%u,%u,%u,%d,%f,%f,%d,%u,%n", &seq, &reading, &timeMs, &angle, &distance,
+             &range, &detecting, &pings, &used) < 8 || used == 0) {
+    return false;
+  }
+  if (pings > RangeFilter::MAX_PINGS) return false;
+
+  out.reading = reading;
+  out.timeMs = timeMs;
+  out.angle = angle;
+  out.distanceCm = distance;
+  out.rangeCm = range;
+  out.detecting = detecting != 0;
+  out.pings = pings;
+
+  // pings fields separated by ';', each a number or empty
+  const char* p = line + used;
+  for (unsigned i = 0; i < pings; i++) {
+    char* end;
+    unsigned long echo = strtoul(p, &end, 10);
+    out.echoUs[i] = end == p ? 0 : (uint32_t)echo;
+    p = end;
+    if (*p == ';') p++;
+    else if (i + 1 < pings) return false;
+  }
+  return true;
+}
+
+int formatTraceRow(char* buf, size_t size, uint32_t seq, const TraceReading& reading) {
+  int tenths = (int)(reading.distanceCm * 10 + 0.5f);
+  int rangeTenths = (int)(reading.rangeCm * 10 + 0.5f);
+  int len = snprintf(buf, size, "%u,%u,%u,%d,%d.%d,%d.%d,%d,%u,", (unsigned)seq,
+                     (unsigned)reading.reading, (unsigned)reading.timeMs, reading.angle,
+                     tenths / 10, tenths % 10, rangeTenths / 10, rangeTenths % 10,
+                     reading.detecting ? 1 : 0, reading.pings);
+  for (uint8_t i = 0; i < reading.pings && len >= 0 && (size_t)len < size; i++) {
+    const char* separator = i > 0 ? ";" : "";
+    if (reading.echoUs[i] == 0) len += snprintf(buf + len, size - len, "%s", separator);
+    else len += snprintf(buf + len, size - len, "%s%u", separator, (unsigned)reading.echoUs[i]);
+  }
+  return len;
+}
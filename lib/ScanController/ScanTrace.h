@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RangeFilter.h"
+
+// ===== Scan trace =====
+// One reading as a CSV row, in the column layout tools/telemetry_decode
+// writes from a device capture:
+//
+//   seq,reading,time_ms,angle_deg,distance_cm,range_cm,detecting,pings,echo_us
+//
+// echo_us holds the raw echo width of every ping, ';'-separated, empty for
+// a ping that timed out. Those echoes and range_cm are everything the
+// scan logic consumed, so a trace can be replayed into it; the other
+// columns are what it produced.
+struct TraceReading {
+  uint32_t reading;
+  uint32_t timeMs;
+  int angle;
+  float distanceCm;
+  float rangeCm;
+  bool detecting;
+  uint8_t pings;
+  uint32_t echoUs[RangeFilter::MAX_PINGS];  // 0 = no echo
+};
+
+extern const char TRACE_HEADER[];
+
+// False for the header and anything malformed
+bool parseTraceRow(const char* line, TraceReading& out);
+// Row without the newline; returns its length (snprintf semantics)
+int formatTraceRow(char* buf, size_t size, uint32_t seq, const TraceReading& reading);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "JsonWriter.h"
+#include "LcdFrame.h"
+#include "MetricsWriter.h"
+#include "PeriodMonitor.h"
+#include "ScanController.h"
+#include "ScanFrame.h"
+
+// ===== Scan views =====
+// How scan state is presented, shared by the device and host builds so
+// both serve the same JSON and draw the same status screen.
+
+inline void writeSampleJson(JsonWriter& json, const RadarSample& sample, float range) {
+  json.beginObject()
+      .field("angle", sample.angle)
+      .field("distance", sample.distance, 1)
+      .field("range", range, 1)
+      .endObject();
+}
+
+// Whole scan frame: one [distance, timestampMs, sweep] triple per
+// STEP_DEG bin, starting at 0 degrees
+template <int STEP_DEG>
+void writeScanJson(JsonWriter& json, const ScanFrame<STEP_DEG>& frame, uint32_t sweep,
+                   uint32_t nowMs, float range) {
+  json.beginObject()
+      .field("step", STEP_DEG)
+      .field("sweep", sweep)
+      .field("now", nowMs)
+      .field("range", range, 1)
+      .key("slots").beginArray();
+  for (int bin = 0; bin < frame.BINS; bin++) {
+    ScanSlot slot = frame.read(bin);
+    json.beginArray().value(slot.distance, 1).value(slot.timestampMs).value(slot.sweep).endArray();
+  }
+  json.endArray().endObject();
+}
+
+// Scan counters for /metrics. Rates (pings per second and so on) are left
+// to the scraper: rate(radar_pings_total[1m]).
+inline void writeScanMetrics(MetricsWriter& metrics, const ScanController& scan,
+                             const EchoStats& echo) {
+  metrics.counter("radar_readings_total", "Filtered readings.", scan.readings())
+      .counter("radar_sweeps_total", "Completed sweeps.", scan.sweep())
+      .gauge("radar_sweep_duration_seconds", "Last sweep.", scan.lastSweepMs(), 3)
+      .counter("radar_pings_total", "Pings fired.", echo.pings)
+      .counter("radar_echo_timeouts_total", "Pings without an echo in time, range-gated ones included.",
+               echo.timeouts)
+      .gauge("radar_detection_limit_meters", "Detection limit.",
+             (uint64_t)(scan.limit() * 10 + 0.5f), 3)
+      .gauge("radar_detecting", "Object inside the limit.", scan.detecting() ? 1 : 0);
+}
+
+// One period SLA: radar_<name>_period_seconds as a histogram, plus its
+// violation count and whether the last period was over the limit
+inline void writePeriodMetrics(MetricsWriter& metrics, const char* name,
+                               const PeriodMonitor& monitor) {
+  uint32_t bounds[PeriodMonitor::BUCKETS - 1];
+  uint32_t counts[PeriodMonitor::BUCKETS];
+  for (int i = 0; i < PeriodMonitor::BUCKETS; i++) {
+    if (i < PeriodMonitor::BUCKETS - 1) bounds[i] = monitor.boundMs(i);
+    counts[i] = monitor.bucketCount(i);
+  }
+
+  char metric[64];
+  snprintf(metric, sizeof(metric), "radar_%s_period_seconds", name);
+  metrics.histogram(metric, "Time between events.", bounds, counts, PeriodMonitor::BUCKETS,
+                    monitor.totalMs(), 3);
+  snprintf(metric, sizeof(metric), "radar_%s_period_violations_total", name);
+  metrics.counter(metric, "Periods over the limit.", monitor.violations());
+  snprintf(metric, sizeof(metric), "radar_%s_period_violated", name);
+  metrics.gauge(metric, "Last period over the limit.", monitor.violated() ? 1 : 0);
+}
+
+// Redraws the whole status screen into the frame; the diff in flush()
+// keeps I2C traffic down to the digits that changed.
+inline void drawStatus(LcdFrame& lcd, const RadarSample& sample) {
+  if (sample.detecting) {
+    int tenths = (int)(sample.distance * 10 + 0.5f);
+    lcd.printLine(0, "Object Detected!");
+    lcd.printLine(1, "%d.%dcm @%ddeg", tenths / 10, tenths % 10, sample.angle);
+    return;
+  }
+
+  // Normal scanning display
+  lcd.printLine(0, "Scan:%ddeg", sample.angle);
+  lcd.printLine(1, "R:%d D:%d", (int)(sample.range + 0.5f), (int)(sample.distance + 0.5f));
+}
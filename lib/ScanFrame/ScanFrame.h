@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// ===== Scan slot =====
+struct ScanSlot {
+  float distance;        // cm; 0 until the bin has been measured
+  uint32_t timestampMs;  // When the reading completed
+  uint32_t sweep;        // Sweep sequence number the reading belongs to
+};
+
+// ===== Angle-indexed scan frame =====
+// One slot per scan-step bin from 0 to 180 degrees. A single writer (the
+// sensor task) updates slots while readers copy them out; each slot carries
+// a sequence counter so a reader never sees a half-written slot.
+template <int STEP_DEG>
+class ScanFrame {
+public:
+  static const int BINS = 180 / STEP_DEG + 1;
+
+  static int binForAngle(int angle) {
+    if (angle < 0) return 0;
+    if (angle > 180) return BINS - 1;
+    return (angle + STEP_DEG / 2) / STEP_DEG;
+  }
+  static int angleForBin(int bin) { return bin * STEP_DEG; }
+
+  void update(int angle, float distance, uint32_t timestampMs, uint32_t sweep) {
+    Entry& entry = entries_[binForAngle(angle)];
+    uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+    entry.seq.store(seq + 1, std::memory_order_relaxed);  // Odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.slot.distance = distance;
+    entry.slot.timestampMs = timestampMs;
+    entry.slot.sweep = sweep;
+    entry.seq.store(seq + 2, std::memory_order_release);
+  }
+
+  ScanSlot read(int bin) const {
+    const Entry& entry = entries_[bin];
+    ScanSlot slot;
+    uint32_t before, after;
+    do {
+      before = entry.seq.load(std::memory_order_acquire);
+      slot.distance = entry.slot.distance;
+      slot.timestampMs = entry.slot.timestampMs;
+      slot.sweep = entry.slot.sweep;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = entry.seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return slot;
+  }
+
+private:
+  struct Entry {
+    std::atomic<uint32_t> seq{0};
+    volatile ScanSlot slot = { 0, 0, 0 };
+  };
+
+  Entry entries_[BINS];
+};
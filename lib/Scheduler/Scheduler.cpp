@@ -0,0 +1,95 @@
+#include "Scheduler.h"
+
+static bool dueBy(uint32_t dueMs, uint32_t nowMs) {
+  return (int32_t)(dueMs - nowMs) <= 0;
+}
+
+void Scheduler::schedule(SchedJob& job, uint32_t nowMs, uint32_t delayMs) {
+  cancel(job);
+  job.dueMs_ = nowMs + delayMs;
+  insert(job);
+}
+
+void Scheduler::cancel(SchedJob& job) {
+  if (job.state_ == SchedJob::IDLE) return;
+  unlink(job);
+  job.state_ = SchedJob::IDLE;
+}
+
+// A job due before the cursor goes in the cursor's slot, which the next
+// run() looks at first
+void Scheduler::insert(SchedJob& job) {
+  uint32_t slotMs = dueBy(job.dueMs_, cursorMs_) ? cursorMs_ : job.dueMs_;
+  SchedJob*& head = slots_[slotMs % SLOTS];
+  job.next_ = head;
+  head = &job;
+  job.state_ = SchedJob::WAITING;
+}
+
+void Scheduler::unlink(SchedJob& job) {
+  SchedJob** link = &ready_;
+  if (job.state_ == SchedJob::WAITING) {
+    uint32_t slotMs = dueBy(job.dueMs_, cursorMs_) ? cursorMs_ : job.dueMs_;
+    link = &slots_[slotMs % SLOTS];
+  }
+  while (*link != nullptr && *link != &job) link = &(*link)->next_;
+  if (*link == &job) *link = job.next_;
+  job.next_ = nullptr;
+}
+
+uint32_t Scheduler::run(uint32_t nowMs) {
+  // Move everything due into the ready list, oldest slot first; after a
+  // gap of a whole revolution or more, each slot is visited once
+  uint32_t elapsed = nowMs - cursorMs_;
+  uint32_t steps = elapsed < SLOTS ? elapsed + 1 : SLOTS;
+  SchedJob** readyTail = &ready_;
+  while (*readyTail != nullptr) readyTail = &(*readyTail)->next_;
+  for (uint32_t i = 0; i < steps; i++) {
+    SchedJob** link = &slots_[(cursorMs_ + i) % SLOTS];
+    while (*link != nullptr) {
+      SchedJob* job = *link;
+      if (!dueBy(job->dueMs_, nowMs)) {
+        link = &job->next_;
+        continue;
+      }
+      *link = job->next_;
+      job->next_ = nullptr;
+      job->state_ = SchedJob::READY;
+      *readyTail = job;
+      readyTail = &job->next_;
+    }
+  }
+  cursorMs_ = nowMs;
+
+  // Jobs may schedule or cancel any job, themselves included; one that
+  // asks to run again at once waits for the next run()
+  while (ready_ != nullptr) {
+    SchedJob* job = ready_;
+    ready_ = job->next_;
+    job->next_ = nullptr;
+    job->state_ = SchedJob::IDLE;
+
+    uint32_t delayMs = job->run(nowMs);
+    if (delayMs != SCHED_IDLE && job->state_ == SchedJob::IDLE) {
+      job->dueMs_ = nowMs + delayMs;
+      insert(*job);
+    }
+  }
+  return untilNext(nowMs);
+}
+
+// Nearest slot first: the first job found due within one revolution is
+// the next one; otherwise the nearest of the far ones
+uint32_t Scheduler::untilNext(uint32_t nowMs) const {
+  if (ready_ != nullptr) return 0;
+  uint32_t best = SCHED_IDLE;
+  for (uint32_t d = 0; d < SLOTS; d++) {
+    for (SchedJob* job = slots_[(nowMs + d) % SLOTS]; job != nullptr; job = job->next_) {
+      if (dueBy(job->dueMs_, nowMs)) return 0;
+      uint32_t wait = job->dueMs_ - nowMs;
+      if (wait == d) return d;
+      if (wait < best) best = wait;
+    }
+  }
+  return best;
+}
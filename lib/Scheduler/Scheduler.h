@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Cooperative scheduler =====
+// Jobs run to completion and say when they want to run next, like
+// ScanController::poll(): run() returns a delay in ms, or SCHED_IDLE to
+// wait until someone calls schedule() again. The owner calls
+// Scheduler::run() with the current time and sleeps for as long as it
+// returns, so nothing waits inside a job and no stage holds up another.
+//
+// Pending jobs sit in a hashed timer wheel of 1 ms slots: arming and
+// firing cost O(1), and jobs due further out than one revolution wait
+// in their slot until their time comes round. Jobs are intrusive; there
+// is no heap use. A scheduler belongs to one task. Time comes in from
+// the caller, so a VirtualClock drives it just as well.
+const uint32_t SCHED_IDLE = UINT32_MAX;
+
+class SchedJob {
+public:
+  virtual ~SchedJob() {}
+  virtual uint32_t run(uint32_t nowMs) = 0;
+
+  bool pending() const { return state_ != IDLE; }
+
+private:
+  friend class Scheduler;
+  enum State : uint8_t { IDLE, WAITING, READY };
+
+  SchedJob* next_ = nullptr;
+  uint32_t dueMs_ = 0;
+  State state_ = IDLE;
+};
+
+// Calls fn every periodMs, starting when first scheduled
+class PeriodicJob : public SchedJob {
+public:
+  typedef void (*Fn)(uint32_t nowMs);
+
+  PeriodicJob(Fn fn, uint32_t periodMs) : fn_(fn), periodMs_(periodMs) {}
+  uint32_t run(uint32_t nowMs) override {
+    fn_(nowMs);
+    return periodMs_;
+  }
+
+private:
+  Fn fn_;
+  uint32_t periodMs_;
+};
+
+// Calls fn once per schedule()
+class OneShotJob : public SchedJob {
+public:
+  typedef void (*Fn)(uint32_t nowMs);
+
+  explicit OneShotJob(Fn fn) : fn_(fn) {}
+  uint32_t run(uint32_t nowMs) override {
+    fn_(nowMs);
+    return SCHED_IDLE;
+  }
+
+private:
+  Fn fn_;
+};
+
+class Scheduler {
+public:
+  static const int SLOTS = 64;
+
+  explicit Scheduler(uint32_t nowMs = 0) : cursorMs_(nowMs) {}
+
+  // (Re)arms job to run delayMs after nowMs
+  void schedule(SchedJob& job, uint32_t nowMs, uint32_t delayMs = 0);
+  void cancel(SchedJob& job);
+
+  // Runs every job due by nowMs once and returns the ms until the next
+  // one is due (0 if one already is), or SCHED_IDLE if none is pending
+  uint32_t run(uint32_t nowMs);
+
+  uint32_t untilNext(uint32_t nowMs) const;
+
+private:
+  void insert(SchedJob& job);
+  void unlink(SchedJob& job);
+
+  SchedJob* slots_[SLOTS] = {};
+  SchedJob* ready_ = nullptr;
+  uint32_t cursorMs_;  // Slots up to here have been checked
+};
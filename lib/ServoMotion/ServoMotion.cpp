@@ -0,0 +1,24 @@
+#include "ServoMotion.h"
+
+#include <stdlib.h>
+
+MoveTiming ServoMotion::planMove(int angle) {
+  MoveTiming move = { (int16_t)position_, (int16_t)angle, config_.maxWaitMs, 0, false };
+
+  if (position_ >= 0) {
+    int travel = angle - position_;
+    int direction = travel > 0 ? 1 : (travel < 0 ? -1 : 0);
+    move.reversal = direction != 0 && direction_ != 0 && direction != direction_;
+
+    float waitMs = abs(travel) * config_.msPerDegree + config_.settleMarginMs;
+    if (move.reversal) waitMs += config_.reversalExtraMs;
+    if (waitMs < config_.minWaitMs) waitMs = config_.minWaitMs;
+    if (waitMs > config_.maxWaitMs) waitMs = config_.maxWaitMs;
+    move.waitMs = (uint16_t)(waitMs + 0.5f);
+
+    if (direction != 0) direction_ = direction;
+  }
+
+  position_ = angle;
+  return move;
+}
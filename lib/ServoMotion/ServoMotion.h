@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Servo motion model =====
+// Estimates how long the servo needs to reach and settle at a new angle
+// from its slew rate, instead of waiting a fixed time for every move.
+// Reversing direction costs extra: the horn has to decelerate, take up
+// gear backlash and accelerate the other way.
+struct ServoMotionConfig {
+  float msPerDegree;         // Slew time under load (SG90: ~1.7 at 4.8V, no load)
+  uint16_t settleMarginMs;   // Ringing after the horn stops
+  uint16_t reversalExtraMs;  // Added when the move reverses direction
+  uint16_t minWaitMs;
+  uint16_t maxWaitMs;        // Also used for the first move from an unknown position
+};
+
+// One planned move, kept for timing logs
+struct MoveTiming {
+  int16_t from;
+  int16_t to;
+  uint16_t waitMs;      // Planned settle wait
+  uint16_t elapsedMs;   // Move command to reading complete, filled in by the caller
+  bool reversal;
+};
+
+class ServoMotion {
+public:
+  explicit ServoMotion(const ServoMotionConfig& config) : config_(config) {}
+
+  // Plans a move to angle and returns the wait in ms before measuring
+  MoveTiming planMove(int angle);
+
+  int position() const { return position_; }
+  const ServoMotionConfig& config() const { return config_; }
+
+private:
+  ServoMotionConfig config_;
+  int position_ = -1;  // Unknown until the first move
+  int direction_ = 0;  // -1, 0 or +1
+};
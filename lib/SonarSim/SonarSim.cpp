@@ -0,0 +1,154 @@
+#include "SonarSim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const float DEG_TO_RAD = 3.14159265f / 180;
+static const float MIN_RANGE_CM = 2;  // HC-SR04 blind zone
+
+SonarSim::SonarSim() {
+  clear();
+}
+
+void SonarSim::clear() {
+  wallCount_ = 0;
+  objectCount_ = 0;
+  beamDeg_ = 15;          // HC-SR04 datasheet cone
+  maxIncidenceDeg_ = 35;  // Beyond this a flat wall sends the echo elsewhere
+  noiseCm_ = 0.3;
+  noiseFraction_ = 0.005;
+  dropout_ = 0.01;
+  ghost_ = 0.005;
+  maxRangeCm_ = 400;
+  rng_ = 1;
+}
+
+bool SonarSim::addWall(const SonarWall& wall) {
+  if (wallCount_ >= MAX_WALLS) return false;
+  walls_[wallCount_++] = wall;
+  return true;
+}
+
+bool SonarSim::addObject(const SonarObject& object) {
+  if (objectCount_ >= MAX_OBJECTS) return false;
+  objects_[objectCount_++] = object;
+  return true;
+}
+
+bool SonarSim::parseLine(const char* line) {
+  while (*line == ' ' || *line == '\t') line++;
+  if (*line == '\0' || *line == '\n' || *line == '\r' || *line == '#') return true;
+
+  char word[16];
+  int used = 0;
+  if (sscanf(line, "%15s%n", word, &used) != 1) return false;
+  const char* args = line + used;
+
+  float a, b, c, d, e, f;
+  unsigned n;
+  if (strcmp(word, "wall") == 0 && sscanf(args, "%f %f %f %f", &a, &b, &c, &d) == 4) {
+    return addWall({ a, b, c, d });
+  }
+  if (strcmp(word, "object") == 0 && sscanf(args, "%f %f %f", &a, &b, &c) == 3) {
+    return addObject({ a, b, a, b, c, 0 });
+  }
+  if (strcmp(word, "mover") == 0 && sscanf(args, "%f %f %f %f %f %f", &a, &b, &c, &d, &e, &f) == 6) {
+    return addObject({ a, b, c, d, e, (uint32_t)(f * 1000) });
+  }
+  if (strcmp(word, "beam") == 0 && sscanf(args, "%f", &a) == 1) beamDeg_ = a;
+  else if (strcmp(word, "incidence") == 0 && sscanf(args, "%f", &a) == 1) maxIncidenceDeg_ = a;
+  else if (strcmp(word, "noise") == 0 && sscanf(args, "%f %f", &a, &b) == 2) setNoise(a, b);
+  else if (strcmp(word, "dropout") == 0 && sscanf(args, "%f", &a) == 1) dropout_ = a;
+  else if (strcmp(word, "ghost") == 0 && sscanf(args, "%f", &a) == 1) ghost_ = a;
+  else if (strcmp(word, "seed") == 0 && sscanf(args, "%u", &n) == 1) seed(n);
+  else return false;
+  return true;
+}
+
+// Distance along a unit ray from the origin to the nearest surface that
+// faces it squarely enough to echo; 0 if none
+float SonarSim::castRay(float dx, float dy, uint32_t timeMs) const {
+  float cosLimit = cosf(maxIncidenceDeg_ * DEG_TO_RAD);
+  float nearest = 0;
+
+  for (int i = 0; i < wallCount_; i++) {
+    const SonarWall& w = walls_[i];
+    float ex = w.x2 - w.x1;
+    float ey = w.y2 - w.y1;
+    float denom = dx * ey - dy * ex;
+    if (fabsf(denom) < 1e-6f) continue;  // Parallel
+    float t = (w.x1 * ey - w.y1 * ex) / denom;
+    float u = (w.x1 * dy - w.y1 * dx) / denom;
+    if (t <= 0 || u < 0 || u > 1) continue;
+    float squareness = fabsf(dx * ey - dy * ex) / sqrtf(ex * ex + ey * ey);
+    if (squareness < cosLimit) continue;
+    if (nearest == 0 || t < nearest) nearest = t;
+  }
+
+  for (int i = 0; i < objectCount_; i++) {
+    const SonarObject& o = objects_[i];
+    float cx = o.x1;
+    float cy = o.y1;
+    if (o.periodMs > 0) {
+      float phase = (float)(timeMs % o.periodMs) / o.periodMs;
+      float s = phase < 0.5f ? 2 * phase : 2 - 2 * phase;
+      cx += s * (o.x2 - o.x1);
+      cy += s * (o.y2 - o.y1);
+    }
+    float along = dx * cx + dy * cy;
+    float disc = along * along - (cx * cx + cy * cy - o.radius * o.radius);
+    if (disc < 0) continue;
+    float t = along - sqrtf(disc);
+    if (t <= 0) continue;
+    float squareness = fabsf(dx * (t * dx - cx) + dy * (t * dy - cy)) / o.radius;
+    if (squareness < cosLimit) continue;
+    if (nearest == 0 || t < nearest) nearest = t;
+  }
+  return nearest;
+}
+
+float SonarSim::trueRangeCm(float angleDeg, uint32_t timeMs) const {
+  float nearest = 0;
+  for (int ray = 0; ray < RAYS; ray++) {
+    float offset = beamDeg_ * ((float)ray / (RAYS - 1) - 0.5f);
+    float rad = (angleDeg + offset) * DEG_TO_RAD;
+    float t = castRay(cosf(rad), sinf(rad), timeMs);
+    if (t > 0 && (nearest == 0 || t < nearest)) nearest = t;
+  }
+  return nearest > maxRangeCm_ ? 0 : nearest;
+}
+
+SonarEcho SonarSim::ping(float angleDeg, uint32_t timeMs) {
+  SonarEcho echo;
+  echo.trueCm = trueRangeCm(angleDeg, timeMs);
+  echo.measuredCm = 0;
+
+  if (random() < dropout_) return echo;
+  if (random() < ghost_) {
+    float farthest = echo.trueCm > 0 ? echo.trueCm : maxRangeCm_;
+    echo.measuredCm = MIN_RANGE_CM + random() * (farthest - MIN_RANGE_CM);
+    return echo;
+  }
+  if (echo.trueCm == 0) return echo;
+
+  float sigma = noiseCm_ + noiseFraction_ * echo.trueCm;
+  echo.measuredCm = echo.trueCm + sigma * gaussian();
+  if (echo.measuredCm < MIN_RANGE_CM) echo.measuredCm = MIN_RANGE_CM;
+  return echo;
+}
+
+// xorshift32
+float SonarSim::random() {
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 17;
+  rng_ ^= rng_ << 5;
+  return (rng_ >> 8) * (1.0f / 16777216);
+}
+
+// Box-Muller; the second value is thrown away to keep the state simple
+float SonarSim::gaussian() {
+  float u = random();
+  if (u < 1e-7f) u = 1e-7f;
+  return sqrtf(-2 * logf(u)) * cosf(2 * 3.14159265f * random());
+}
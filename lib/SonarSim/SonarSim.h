@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+// ===== Ultrasonic scene simulator =====
+// A 2D scene the radar looks at: the sensor sits at the origin, 0 degrees
+// points along +x and 90 along +y, distances are cm. A ping casts a fan of
+// rays across the beam cone and returns the nearest surface that would
+// echo back. Walls only echo when hit within maxIncidenceDeg of square on
+// (ultrasound reflects off flat surfaces like a mirror). The noise,
+// dropout and ghost models then turn that into what an HC-SR04 would
+// report. Fixed-size tables and a seeded PRNG: no heap, and the same seed
+// gives the same echoes.
+//
+// Scenes can be built in code or parsed line by line:
+//
+//   wall  x1 y1 x2 y2
+//   object x y radius
+//   mover x1 y1 x2 y2 radius periodS   (back and forth, one round trip per period)
+//   beam degrees                        (full cone width)
+//   incidence degrees
+//   noise sigmaCm fraction              (sigma = sigmaCm + fraction * distance)
+//   dropout probability
+//   ghost probability                   (spurious short echo)
+//   seed n
+//
+// '#' starts a comment.
+struct SonarWall {
+  float x1, y1, x2, y2;
+};
+
+struct SonarObject {
+  float x1, y1;      // Position at t = 0
+  float x2, y2;      // Far end of the path; same as x1, y1 for a fixed object
+  float radius;
+  uint32_t periodMs; // 0 = fixed
+};
+
+// One simulated ping
+struct SonarEcho {
+  float trueCm;      // Nearest echoing surface, noise-free; 0 if none in range
+  float measuredCm;  // What the sensor reports; 0 for no echo
+};
+
+class SonarSim {
+public:
+  static const int MAX_WALLS = 32;
+  static const int MAX_OBJECTS = 16;
+  static const int RAYS = 15;  // Across the beam cone
+
+  SonarSim();
+
+  void clear();  // Empty scene, default sensor model
+  bool addWall(const SonarWall& wall);
+  bool addObject(const SonarObject& object);
+  // Returns false for a line it does not understand
+  bool parseLine(const char* line);
+
+  void setBeamDeg(float deg) { beamDeg_ = deg; }
+  void setMaxIncidenceDeg(float deg) { maxIncidenceDeg_ = deg; }
+  void setNoise(float sigmaCm, float fraction) { noiseCm_ = sigmaCm; noiseFraction_ = fraction; }
+  void setDropout(float probability) { dropout_ = probability; }
+  void setGhost(float probability) { ghost_ = probability; }
+  void setMaxRangeCm(float cm) { maxRangeCm_ = cm; }
+  void seed(uint32_t seed) { rng_ = seed ? seed : 1; }
+
+  // Noise-free nearest echo at a servo angle and time; 0 if none
+  float trueRangeCm(float angleDeg, uint32_t timeMs) const;
+  // One ping, with the sensor model applied (advances the PRNG)
+  SonarEcho ping(float angleDeg, uint32_t timeMs);
+
+  int walls() const { return wallCount_; }
+  int objects() const { return objectCount_; }
+
+private:
+  float castRay(float dx, float dy, uint32_t timeMs) const;
+  float random();    // [0, 1)
+  float gaussian();  // Mean 0, sigma 1
+
+  SonarWall walls_[MAX_WALLS];
+  SonarObject objects_[MAX_OBJECTS];
+  int wallCount_ = 0;
+  int objectCount_ = 0;
+
+  float beamDeg_;
+  float maxIncidenceDeg_;
+  float noiseCm_;
+  float noiseFraction_;
+  float dropout_;
+  float ghost_;
+  float maxRangeCm_;
+  uint32_t rng_;
+};
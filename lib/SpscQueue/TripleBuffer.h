@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// ===== Latest-value triple buffer =====
+// Lock-free single-producer / single-consumer mailbox that only keeps the
+// newest value. The producer never waits and never overwrites the copy
+// the consumer is reading; intermediate values are dropped, which
+// coalesces bursts of updates into one.
+template <typename T>
+class TripleBuffer {
+public:
+  void publish(const T& value) {
+    buffers_[back_] = value;
+    uint32_t previous = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+    back_ = previous & INDEX_MASK;
+  }
+
+  // Returns false if nothing new was published since the last take()
+  bool take(T& value) {
+    if (!(middle_.load(std::memory_order_acquire) & FRESH)) return false;
+    uint32_t previous = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & INDEX_MASK;
+    value = buffers_[front_];
+    return true;
+  }
+
+private:
+  static const uint32_t INDEX_MASK = 3;
+  static const uint32_t FRESH = 4;
+
+  T buffers_[3];
+  uint32_t back_ = 0;                 // Producer's slot
+  std::atomic<uint32_t> middle_{1};   // Handoff slot, FRESH when unread
+  uint32_t front_ = 2;                // Consumer's slot
+};
@@ -0,0 +1,174 @@
+#include "Telemetry.h"
+
+#include <string.h>
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t codeAt = 0;
+  size_t o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; i++) {
+    if (in[i] != 0) {
+      out[o++] = in[i];
+      code++;
+    }
+    if (in[i] == 0 || code == 0xFF) {
+      out[codeAt] = code;
+      codeAt = o++;
+      code = 1;
+    }
+  }
+  out[codeAt] = code;
+  return o;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out) {
+  size_t i = 0;
+  size_t o = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) return 0;
+    for (uint8_t k = 1; k < code; k++) {
+      if (in[i] == 0) return 0;
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < len) out[o++] = 0;
+  }
+  return o;
+}
+
+static uint8_t* put16(uint8_t* p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+  p = put16(p, v);
+  return put16(p, v >> 16);
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+size_t TelemetryEncoder::encodeSample(const TelemetrySample& sample, uint8_t* out) {
+  uint8_t raw[3 + TELEMETRY_MAX_PAYLOAD + 2];
+  uint8_t pings = sample.pings > TELEMETRY_MAX_PINGS ? TELEMETRY_MAX_PINGS : sample.pings;
+
+  raw[0] = TELEMETRY_SAMPLE;
+  uint8_t* p = raw + 3;
+  p = put32(p, sample.reading);
+  p = put32(p, sample.timeMs);
+  *p++ = sample.angle;
+  *p++ = sample.detecting ? TELEMETRY_DETECTING : 0;
+  p = put16(p, sample.distanceMm);
+  p = put16(p, sample.rangeMm);
+  *p++ = pings;
+  for (uint8_t i = 0; i < pings; i++) p = put16(p, sample.echoUs[i]);
+  return finish(raw, p - raw, out);
+}
+
+size_t TelemetryEncoder::encodeLog(uint32_t timeMs, uint8_t level, const char* module,
+                                   const char* text, uint8_t* out) {
+  uint8_t raw[3 + TELEMETRY_MAX_PAYLOAD + 2];
+  size_t moduleLen = strlen(module);
+  if (moduleLen > 16) moduleLen = 16;
+
+  raw[0] = TELEMETRY_LOG;
+  uint8_t* p = raw + 3;
+  p = put32(p, timeMs);
+  *p++ = level;
+  *p++ = moduleLen;
+  memcpy(p, module, moduleLen);
+  p += moduleLen;
+
+  // Long lines are cut to fit the payload
+  size_t room = raw + 3 + TELEMETRY_MAX_PAYLOAD - p;
+  size_t textLen = strlen(text);
+  if (textLen > room) textLen = room;
+  memcpy(p, text, textLen);
+  p += textLen;
+  return finish(raw, p - raw, out);
+}
+
+size_t TelemetryEncoder::finish(uint8_t* raw, size_t len, uint8_t* out) {
+  put16(raw + 1, seq_++);
+  put16(raw + len, crc16(raw, len));
+  len += 2;
+  size_t n = cobsEncode(raw, len, out);
+  out[n++] = 0;
+  return n;
+}
+
+bool TelemetryDecoder::feed(uint8_t byte) {
+  if (byte != 0) {
+    if (length_ < sizeof(buffer_)) buffer_[length_++] = byte;
+    else overflow_ = true;
+    return false;
+  }
+
+  // Frame delimiter
+  size_t length = length_;
+  bool overflow = overflow_;
+  length_ = 0;
+  overflow_ = false;
+  if (length == 0) return false;  // Back-to-back delimiters
+
+  size_t n = overflow ? 0 : cobsDecode(buffer_, length, frame_);
+  if (n < 5 || crc16(frame_, n - 2) != get16(frame_ + n - 2)) {
+    badFrames_++;
+    return false;
+  }
+
+  payloadLen_ = n - 5;
+  uint16_t seq = sequence();
+  if (haveSeq_) lostFrames_ += (uint16_t)(seq - lastSeq_ - 1);
+  haveSeq_ = true;
+  lastSeq_ = seq;
+  frames_++;
+  return true;
+}
+
+bool TelemetryDecoder::sample(TelemetrySample& out) const {
+  const uint8_t* p = payload();
+  if (type() != TELEMETRY_SAMPLE || payloadLen_ < 15) return false;
+  out.reading = get32(p);
+  out.timeMs = get32(p + 4);
+  out.angle = p[8];
+  out.detecting = (p[9] & TELEMETRY_DETECTING) != 0;
+  out.distanceMm = get16(p + 10);
+  out.rangeMm = get16(p + 12);
+  out.pings = p[14];
+  if (out.pings > TELEMETRY_MAX_PINGS || payloadLen_ < 15 + 2u * out.pings) return false;
+  for (uint8_t i = 0; i < out.pings; i++) out.echoUs[i] = get16(p + 15 + 2 * i);
+  return true;
+}
+
+bool TelemetryDecoder::log(TelemetryLog& out) const {
+  const uint8_t* p = payload();
+  if (type() != TELEMETRY_LOG || payloadLen_ < 6) return false;
+  out.timeMs = get32(p);
+  out.level = p[4];
+  out.moduleLen = p[5];
+  if (payloadLen_ < 6u + out.moduleLen) return false;
+  out.module = (const char*)p + 6;
+  out.text = out.module + out.moduleLen;
+  out.textLen = payloadLen_ - 6 - out.moduleLen;
+  return true;
+}
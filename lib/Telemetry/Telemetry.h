@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ===== Binary telemetry =====
+// Framed records for machine capture over the UART. A frame is
+//
+//   COBS( type:u8  seq:u16  payload  crc:u16 )  0x00
+//
+// little-endian, CRC-16/CCITT-FALSE over type..payload. COBS removes every
+// zero byte from the frame, so 0x00 only ever marks a frame end and a
+// reader that starts mid-stream resynchronises at the next one. seq counts
+// frames on the stream; a gap means frames were lost on the wire.
+//
+// Sample payload (TELEMETRY_SAMPLE), one per reading:
+//   reading:u32 timeMs:u32 angle:u8 flags:u8 distanceMm:u16 rangeMm:u16
+//   pings:u8 echoUs:u16 x pings (TELEMETRY_NO_ECHO when the ping timed out)
+// `reading` counts readings on the device, so a gap there means samples
+// were dropped before they reached the UART.
+//
+// Log payload (TELEMETRY_LOG), one per text log line:
+//   timeMs:u32 level:u8 moduleLen:u8 module text
+enum TelemetryType : uint8_t {
+  TELEMETRY_SAMPLE = 1,
+  TELEMETRY_LOG = 2,
+};
+
+const uint8_t TELEMETRY_DETECTING = 0x01;  // flags
+const uint16_t TELEMETRY_NO_ECHO = 0xFFFF;
+const size_t TELEMETRY_MAX_PINGS = 9;
+const size_t TELEMETRY_MAX_PAYLOAD = 128;
+// Header, payload and CRC, plus COBS overhead and the delimiter
+const size_t TELEMETRY_MAX_FRAME = 3 + TELEMETRY_MAX_PAYLOAD + 2 + 2 + 1;
+
+struct TelemetrySample {
+  uint32_t reading;
+  uint32_t timeMs;
+  uint8_t angle;
+  bool detecting;
+  uint16_t distanceMm;
+  uint16_t rangeMm;
+  uint8_t pings;
+  uint16_t echoUs[TELEMETRY_MAX_PINGS];
+};
+
+struct TelemetryLog {
+  uint32_t timeMs;
+  uint8_t level;
+  const char* module;  // Points into the decoder's buffer when decoded
+  uint8_t moduleLen;
+  const char* text;
+  size_t textLen;
+};
+
+uint16_t crc16(const uint8_t* data, size_t len);
+
+// Encodes len bytes into out (room for len + len / 254 + 1) without the
+// trailing delimiter; returns the encoded length
+size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out);
+// Decodes in place-safe (out may equal in); returns 0 on malformed input
+size_t cobsDecode(const uint8_t* in, size_t len, uint8_t* out);
+
+// ===== Encoder =====
+// Builds complete frames, delimiter included, into a caller buffer of
+// TELEMETRY_MAX_FRAME bytes. Returns the frame length, 0 if it did not fit.
+class TelemetryEncoder {
+public:
+  size_t encodeSample(const TelemetrySample& sample, uint8_t* out);
+  size_t encodeLog(uint32_t timeMs, uint8_t level, const char* module, const char* text, uint8_t* out);
+
+  uint16_t sequence() const { return seq_; }
+
+private:
+  size_t finish(uint8_t* raw, size_t len, uint8_t* out);
+
+  uint16_t seq_ = 0;
+};
+
+// ===== Decoder =====
+// Byte-at-a-time stream parser. feed() returns true when a valid frame has
+// just ended; its header and payload are then available until the next
+// feed(). Corrupt frames are counted and skipped.
+class TelemetryDecoder {
+public:
+  bool feed(uint8_t byte);
+
+  TelemetryType type() const { return (TelemetryType)frame_[0]; }
+  uint16_t sequence() const { return frame_[1] | (frame_[2] << 8); }
+  bool sample(TelemetrySample& out) const;
+  bool log(TelemetryLog& out) const;
+
+  uint32_t frames() const { return frames_; }
+  uint32_t badFrames() const { return badFrames_; }
+  uint32_t lostFrames() const { return lostFrames_; }  // From sequence gaps
+
+private:
+  const uint8_t* payload() const { return frame_ + 3; }
+
+  uint8_t buffer_[TELEMETRY_MAX_FRAME];
+  size_t length_ = 0;
+  bool overflow_ = false;
+  uint8_t frame_[TELEMETRY_MAX_FRAME];
+  size_t payloadLen_ = 0;
+  bool haveSeq_ = false;
+  uint16_t lastSeq_ = 0;
+  uint32_t frames_ = 0;
+  uint32_t badFrames_ = 0;
+  uint32_t lostFrames_ = 0;
+};
@@ -0,0 +1,66 @@
+# Pre-build step: gzip web/index.html into include/web_index.h.
+#
+# The page is stored compressed in flash and served as-is with
+# Content-Encoding: gzip. The ETag is a hash of the source so browsers can
+# revalidate with If-None-Match and get a 304 instead of the page.
+#
+# Runs from PlatformIO (extra_scripts = pre:scripts/embed_web.py) or
+# standalone: python3 scripts/embed_web.py
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(PROJECT_DIR, "web", "index.html")
+TARGET = os.path.join(PROJECT_DIR, "include", "web_index.h")
+
+
+def render(html):
+    # mtime=0 keeps the output byte-identical across builds
+    packed = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(html).hexdigest()[:16]
+
+    lines = [
+        "// Generated by scripts/embed_web.py from web/index.html - do not edit",
+        "#pragma once",
+        "",
+        "#ifdef ARDUINO",
+        "#include <Arduino.h>",
+        "#else",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "#define PROGMEM  // Host build: plain const data",
+        "#endif",
+        "",
+        '#define WEB_INDEX_ETAG "\\"%s\\""' % etag,
+        "",
+        "const size_t WEB_INDEX_GZ_LEN = %d;  // %d bytes uncompressed" % (len(packed), len(html)),
+        "const uint8_t WEB_INDEX_GZ[] PROGMEM = {",
+    ]
+    for i in range(0, len(packed), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in packed[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        header = render(f.read())
+
+    # Only touch the header when the page changed, to avoid needless rebuilds
+    if os.path.exists(TARGET):
+        with open(TARGET) as f:
+            if f.read() == header:
+                return
+    with open(TARGET, "w") as f:
+        f.write(header)
+    print("embed_web: wrote %s" % os.path.relpath(TARGET, PROJECT_DIR))
+
+
+main()
@@ -1,9 +1,36 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
+#include <WebSocketsServer.h>
 #include <ESP32Servo.h>
 #include <Wire.h>
 #include <LiquidCrystal_I2C.h>
+#include <driver/pcnt.h>
+
+#include "EchoCapture.h"
+#include "EncoderAccel.h"
+#include "Hal.h"
+#include "HttpServer.h"
+#include "JsonWriter.h"
+#include "LcdFrame.h"
+#include "Log.h"
+#include "MetricsWriter.h"
+#include "OccupancyGrid.h"
+#include "Pcf8574LcdSink.h"
+#include "PeriodMonitor.h"
+#include "Profiler.h"
+#include "QuadratureDecoder.h"
+#include "RadarConfig.h"
+#include "RangeFilter.h"
+#include "web_index.h"  // Generated from web/index.html by scripts/embed_web.py
+#include "ScanController.h"
+#include "ScanFrame.h"
+#include "ScanView.h"
+#include "Scheduler.h"
+#include "ServoMotion.h"
+#include "SpscQueue.h"
+#include "Telemetry.h"
+#include "Trace.h"
+#include "TripleBuffer.h"
 
 // ===== Ultrasonic pins =====
 #define TRIG_PIN 4
@@ -20,287 +47,729 @@
 #define SERVO_PIN 13
 
 // ===== Constants =====
-const float MIN_DETECTION_LIMIT = 30.0;
-const float MAX_DETECTION_LIMIT = 400.0;  // HC-SR04 max range ~400cm
-const float RANGE_INCREMENT = 5.0;         // Adjust by 5cm per encoder click
-const int SCAN_STEP = 5;
-const int SCAN_DELAY = 200;
+// Scan and detection settings shared with the host build are in
+// include/RadarConfig.h
+const float RANGE_INCREMENT = 5.0;  // Adjust by 5cm per encoder click
+
+// ===== Range knob =====
+// Slow clicks move RANGE_INCREMENT; a fast spin moves up to 8x that, so
+// 30 -> 400cm takes about ten quick clicks instead of 74.
+const EncoderAccelConfig RANGE_ACCEL = {
+  RANGE_INCREMENT,  // baseStep
+  150,              // slowMsPerDetent
+  25,               // fastMsPerDetent
+  8,                // maxMultiplier
+};
+const unsigned long RANGE_OVERLAY_MS = 800;   // "Range Set" display time
+const unsigned long RESET_OVERLAY_MS = 1000;  // "Range Reset" display time
+const unsigned long IP_SCREEN_MS = 2000;      // Access point address at boot
+const unsigned long BUTTON_DEBOUNCE = 50;
+
+// ===== Logging =====
+// Lines go through logRing and reach the UART from the serial task, so a
+// full TX FIFO never stalls the code that logged. Per-module levels are
+// compile-time; e.g. -DLOG_SCAN_LEVEL=LOG_LEVEL_WARN drops the per-step
+// lines from the build.
+#ifndef LOG_BAUD
+#define LOG_BAUD 115200
+#endif
+#ifndef LOG_SYS_LEVEL
+#define LOG_SYS_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_SCAN_LEVEL
+#define LOG_SCAN_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RANGE_LEVEL
+#define LOG_RANGE_LEVEL LOG_LEVEL_INFO
+#endif
+// Sweep summaries at INFO; LOG_LEVEL_DEBUG adds every servo move's
+// planned wait and measured time
+#ifndef LOG_TIMING_LEVEL
+#define LOG_TIMING_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Distances are logged as tenths with "%d.%d", like JsonWriter does, so
+// newlib's float printf (which can allocate) stays out of the log path
+inline int tenths(float value) {
+  return (int)(value * 10 + 0.5f);
+}
+
+// ===== Serial output =====
+// The UART carries either the text log or binary telemetry frames (see
+// lib/Telemetry and tools/telemetry_decode.cpp). Send 'b' over the serial
+// port to switch to binary and 't' to switch back. In binary mode log
+// lines still arrive, as log frames.
+#ifndef TELEMETRY_BINARY
+#define TELEMETRY_BINARY 0  // Output mode at boot
+#endif
+
+// ===== Profiling =====
+// Per-stage timing histograms (lib/Profiler), read at /profile or by
+// sending 'p' over the serial port; /profile?reset clears them. The same
+// stages are traced as begin/end events: /trace returns the recent ones
+// for tools/trace_to_chrome. Stages in ScanController cover the scan
+// itself; each name starts with its task. -DPROFILING=0 removes it all.
+ProfileStage broadcastStage("net.broadcast");
+ProfileStage httpStage("net.http");
+ProfileStage encoderStage("ui.encoder");
+ProfileStage lcdStage("lcd.flush");
+ProfileStage logStage("serial.log");
+
+// ===== Tasks =====
+// Sensor work owns core 1; Wi-Fi/HTTP and the slow peripherals live on
+// core 0 so neither can stretch the scan period.
+const int SENSOR_CORE = 1;
+const int NETWORK_CORE = 0;
+const int UI_CORE = 0;
+const UBaseType_t SENSOR_PRIORITY = 3;
+const UBaseType_t NETWORK_PRIORITY = 2;
+const UBaseType_t UI_PRIORITY = 1;
+const int LCD_CORE = 0;
+const UBaseType_t LCD_PRIORITY = 1;
+const int SERIAL_CORE = 0;
+const UBaseType_t SERIAL_PRIORITY = 1;
 
 // ===== Wi-Fi =====
 const char* ssid = "ESP32-Radar";
 const char* password = "12345678";
 
+LogRing logRing(millis);
+
 // ===== LCD =====
-LiquidCrystal_I2C lcd(0x27, 16, 2);
+// The PCF8574 is specified for 100kHz; most backpacks also run at 400kHz,
+// which cuts a full repaint from ~25ms to ~7ms.
+#ifndef LCD_I2C_CLOCK
+#define LCD_I2C_CLOCK 100000
+#endif
+const uint8_t LCD_ADDRESS = 0x27;
+const unsigned long LCD_REFRESH_MS = 20;  // Worker's check interval
+
+LiquidCrystal_I2C lcd(LCD_ADDRESS, 16, 2);  // Used only to initialise the panel
+
+void lcdI2cWrite(uint8_t address, const uint8_t* data, size_t len) {
+  Wire.beginTransmission(address);
+  Wire.write(data, len);
+  Wire.endTransmission();
+}
+
+// The UI task draws into lcdFrame and publishes finished screens to
+// lcdMailbox. The LCD task keeps only the newest one, so a burst of
+// updates costs a single repaint of the cells that differ.
+LcdFrame lcdFrame;
+TripleBuffer<LcdScreen> lcdMailbox;
+
+void publishScreen() {
+  lcdMailbox.publish(lcdFrame.screen());
+  lcdFrame.markShown();
+}
+
+HttpServer server(80);
+WebSocketsServer webSocket(81);  // Live sample push, served next to HTTP
+
+// ===== ESP32 HAL =====
+// The device side of lib/Hal; src/native/ has the Linux side.
+class ArduinoClock : public HalClock {
+public:
+  uint32_t millis() override { return ::millis(); }
+  uint32_t micros() override { return ::micros(); }
+};
+
+class PwmServo : public HalServo {
+public:
+  void attach(int pin) { servo_.attach(pin); }
+  void write(int angle) override { servo_.write(angle); }
+
+private:
+  Servo servo_;
+};
+
+class GpioOutputs : public HalOutputs {
+public:
+  void setAlarm(bool on) override {
+    digitalWrite(LED_PIN, on ? HIGH : LOW);
+    digitalWrite(BUZZER_PIN, on ? HIGH : LOW);
+  }
+};
+
+// HTTP on port 80 for the page and polling, WebSocket on 81 for the push
+class WebSocketNetwork : public HalNetwork {
+public:
+  bool hasSubscribers() override { return webSocket.connectedClients() > 0; }
+  void broadcast(const char* text, size_t len) override { webSocket.broadcastTXT(text, len); }
+  void poll(uint32_t timeoutMs) override {
+    server.poll(timeoutMs);  // Sleeps in select() until a client needs service
+    webSocket.loop();
+  }
+};
 
-WebServer server(80);
-Servo radarServo;
+ArduinoClock halClock;
+PwmServo radarServo;
+GpioOutputs outputs;
+WebSocketNetwork network;
 
 // ===== Variables =====
-int currentAngle = 0;
-bool movingForward = true;
-float lastDistance = 0;
-bool isDetecting = false;
-float detectionLimit = MIN_DETECTION_LIMIT;  // Dynamic detection range
+// Latest reading per SCAN_STEP bin, written by the sensor task
+ScanFrame<SCAN_STEP> scanFrame;
+// What has been seen where, kept across sweeps; sensor task writes
+OccupancyGrid<SCAN_STEP, GRID_RANGE_BINS, GRID_CELL_CM> occupancy(OCCUPANCY);
+
+// Written by the UI task, read by the sensor task
+volatile float detectionLimit = MIN_DETECTION_LIMIT;  // Dynamic detection range
+
+// ===== Pipeline =====
+// One sample per reading, published by the sensor task to each consumer
+SpscQueue<RadarSample, 16> networkQueue;  // Sensor -> network
+SpscQueue<RadarSample, 16> uiQueue;       // Sensor -> UI
+SpscQueue<MoveTiming, 16> moveLogQueue;   // Sensor -> UI, per-move timing
+SpscQueue<SweepTiming, 4> sweepLogQueue;  // Sensor -> UI, at each reversal
+volatile uint32_t droppedSamples = 0;      // Samples a full queue refused
+
+// How late each sensor task sleep ended against the time poll() asked
+// for; written by the sensor task, scraped at /metrics
+volatile uint32_t sensorWakeups = 0;
+volatile uint32_t sensorLateUs = 0;         // Sum; wraps like any counter
+volatile uint32_t sensorSweepMaxLateUs = 0;  // Worst in the last completed sweep
+uint32_t sensorMaxLateUs = 0;                // Worst in the sweep under way
+
+// Update-rate SLA, fed by the sensor task; the UI task logs each miss
+PeriodMonitor readingPeriod(READING_PERIOD_LIMIT_MS);
+PeriodMonitor sweepPeriod(SWEEP_PERIOD_LIMIT_MS);
+
+// Sensor -> serial task, filled only while binary output is selected
+SpscQueue<TelemetrySample, 16> telemetryQueue;
+volatile bool telemetryBinary = TELEMETRY_BINARY;
+uint32_t readingCount = 0;  // Sensor task; numbers telemetry samples
+
+RadarSample latestSample = { 0, 0, MIN_DETECTION_LIMIT, false };  // Network task copy
 
 // ===== Encoder Variables =====
-volatile int encoderPos = 0;
+// Decoded by the PCNT peripheral; only the UI task reads it
+const pcnt_unit_t ENCODER_UNIT = PCNT_UNIT_0;
+const uint16_t ENCODER_FILTER = 1023;  // APB cycles (~12.8us), the hardware maximum
+int32_t encoderCounts = 0;
+int encoderPos = 0;  // Detents
 int lastEncoderPos = 0;
-bool lastCLK = HIGH;
-unsigned long lastEncoderUpdate = 0;
-const unsigned long ENCODER_DEBOUNCE = 5;  // 5ms debounce
-
-// ===== Distance measurement with better filtering =====
-float getDistance() {
-  // Take 3 readings and use median to reduce noise
-  float readings[3];
-  for(int i = 0; i < 3; i++) {
+
+// ===== Ultrasonic echo source =====
+// Fires the HC-SR04 trigger; the echo line is timed by an edge interrupt
+// instead of blocking in pulseIn().
+class GpioEchoSource : public EchoSource {
+public:
+  void trigger(uint32_t nowUs) override {
     digitalWrite(TRIG_PIN, LOW);
     delayMicroseconds(2);
     digitalWrite(TRIG_PIN, HIGH);
     delayMicroseconds(10);
     digitalWrite(TRIG_PIN, LOW);
-    
-    long duration = pulseIn(ECHO_PIN, HIGH, 30000);
-    readings[i] = duration * 0.0343 / 2;
-    if(i < 2) delayMicroseconds(50);
-  }
-  
-  // Simple bubble sort for median
-  if(readings[0] > readings[1]) { float t = readings[0]; readings[0] = readings[1]; readings[1] = t; }
-  if(readings[1] > readings[2]) { float t = readings[1]; readings[1] = readings[2]; readings[2] = t; }
-  if(readings[0] > readings[1]) { float t = readings[0]; readings[0] = readings[1]; readings[1] = t; }
-  
-  float distance = readings[1];  // Return median
-  
-  if (distance <= 0 || distance > MAX_DETECTION_LIMIT) {
-    distance = MAX_DETECTION_LIMIT;
   }
-  return distance;
+};
+
+GpioEchoSource echoSource;
+EchoCapture echoCapture(echoSource);
+
+void IRAM_ATTR onEchoEdge() {
+  echoCapture.onEdge(digitalRead(ECHO_PIN), micros());
 }
 
-// ===== Encoder interrupt handler =====
-void IRAM_ATTR readEncoder() {
-  if (millis() - lastEncoderUpdate < ENCODER_DEBOUNCE) return;
-  
-  bool clkState = digitalRead(ENCODER_CLK);
-  bool dtState = digitalRead(ENCODER_DT);
-  
-  if (clkState != lastCLK && clkState == LOW) {
-    if (dtState != clkState) {
-      encoderPos++;  // Clockwise
-    } else {
-      encoderPos--;  // Counter-clockwise
-    }
-    lastEncoderUpdate = millis();
-  }
-  lastCLK = clkState;
+// ===== Encoder decoding =====
+// x4 quadrature decoding in the pulse counter: channel 0 counts CLK edges
+// with DT as direction, channel 1 counts DT edges with CLK as direction.
+// Clockwise (CLK leading) counts up, matching QuadratureDecoder. Bounce on
+// one line produces +1/-1 pairs that cancel, and the glitch filter drops
+// the shortest spikes, so no interrupt or software debounce is needed.
+void setupEncoder() {
+  pcnt_config_t config = {};
+  config.unit = ENCODER_UNIT;
+  config.counter_h_lim = INT16_MAX;
+  config.counter_l_lim = INT16_MIN;
+
+  config.channel = PCNT_CHANNEL_0;
+  config.pulse_gpio_num = ENCODER_CLK;
+  config.ctrl_gpio_num = ENCODER_DT;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DEC;
+  config.lctrl_mode = PCNT_MODE_KEEP;
+  config.hctrl_mode = PCNT_MODE_REVERSE;
+  pcnt_unit_config(&config);
+
+  config.channel = PCNT_CHANNEL_1;
+  config.pulse_gpio_num = ENCODER_DT;
+  config.ctrl_gpio_num = ENCODER_CLK;
+  config.lctrl_mode = PCNT_MODE_REVERSE;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  pcnt_unit_config(&config);
+
+  pcnt_set_filter_value(ENCODER_UNIT, ENCODER_FILTER);
+  pcnt_filter_enable(ENCODER_UNIT);
+  pcnt_counter_pause(ENCODER_UNIT);
+  pcnt_counter_clear(ENCODER_UNIT);
+  pcnt_counter_resume(ENCODER_UNIT);
+}
+
+// Folds the hardware counter into encoderPos and clears it. The PCNT does
+// not wrap: reaching a limit resets it to 0, so a running difference of
+// 16-bit readings would jump by a whole range. Cleared on every poll, a
+// reading is the change since the last one and never nears the limits.
+// An edge landing between the read and the clear is lost; at the glitch
+// filter's 12.8us minimum spacing that window rarely catches one.
+void pollEncoder() {
+  int16_t counter = 0;
+  pcnt_get_counter_value(ENCODER_UNIT, &counter);
+  if (counter == 0) return;
+  pcnt_counter_clear(ENCODER_UNIT);
+  encoderCounts += counter;
+  encoderPos = QuadratureDecoder::countsToDetents(encoderCounts);
 }
 
 // ===== Update detection limit based on encoder =====
-void updateDetectionLimit() {
+EncoderAccel rangeAccel(RANGE_ACCEL);
+
+void showOverlay(const char* title, float limit, unsigned long duration);
+
+void updateDetectionLimit(uint32_t nowMs) {
+  PROFILE_SCOPE(encoderStage);
+  pollEncoder();
   if (encoderPos != lastEncoderPos) {
     int delta = encoderPos - lastEncoderPos;
-    detectionLimit += (delta * RANGE_INCREMENT);
+    float limit = detectionLimit + rangeAccel.step(delta, nowMs);
     
-    // Constrain to valid range
-    if (detectionLimit < MIN_DETECTION_LIMIT) {
-      detectionLimit = MIN_DETECTION_LIMIT;
-      encoderPos = lastEncoderPos;  // Stop at minimum
-    } else if (detectionLimit > MAX_DETECTION_LIMIT) {
-      detectionLimit = MAX_DETECTION_LIMIT;
-      encoderPos = lastEncoderPos;  // Stop at maximum
+    // Constrain to valid range; turning past an end is simply lost
+    if (limit < MIN_DETECTION_LIMIT) {
+      limit = MIN_DETECTION_LIMIT;  // Stop at minimum
+    } else if (limit > MAX_DETECTION_LIMIT) {
+      limit = MAX_DETECTION_LIMIT;  // Stop at maximum
     }
     
+    detectionLimit = limit;
     lastEncoderPos = encoderPos;
     
-    Serial.printf("Detection limit changed to: %.1f cm\n", detectionLimit);
+    int limitTenths = tenths(limit);
+    LOG_INFO(RANGE, "Detection limit changed to: %d.%d cm (x%d)", limitTenths / 10, limitTenths % 10,
+             rangeAccel.lastMultiplier());
     
-    // Show on LCD temporarily
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print("Range Set:");
-    lcd.setCursor(0, 1);
-    lcd.print(String(detectionLimit, 0) + " cm");
-    delay(800);
-    lcd.clear();
+    // Show on LCD temporarily; the overlay expires on its own
+    showOverlay("Range Set:", limit, RANGE_OVERLAY_MS);
   }
 }
 
-// ===== Web page with dynamic range display =====
-const char MAIN_page[] PROGMEM = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-  <meta charset="utf-8">
-  <title>ESP32 Radar</title>
-  <style>
-    body {
-      background: #0a0a0a;
-      color: white;
-      text-align: center;
-      font-family: 'Segoe UI', sans-serif;
-      margin: 0;
-      padding: 20px;
-    }
-    h2 { margin: 10px 0; color: #0f0; }
-    canvas {
-      background: #000;
-      margin: 20px auto;
-      border: 2px solid #0f0;
-      border-radius: 50%;
-      display: block;
-    }
-    #info {
-      font-size: 18px;
-      margin: 15px 0;
-    }
-    #range {
-      font-size: 16px;
-      color: #0ff;
-      margin: 10px 0;
-      padding: 10px;
-      background: rgba(0, 255, 255, 0.1);
-      border-radius: 5px;
-      display: inline-block;
-    }
-    .detecting {
-      color: #f00;
-      font-weight: bold;
-      animation: blink 1s infinite;
-    }
-    @keyframes blink {
-      0%, 50% { opacity: 1; }
-      51%, 100% { opacity: 0.3; }
-    }
-  </style>
-</head>
-<body>
-  <h2>ESP32 Ultrasonic Radar</h2>
-  <div id="range">Detection Range: <span id="rangeValue">--</span> cm</div>
-  <canvas id="radar" width="400" height="400"></canvas>
-  <p id="info">Angle: --°, Distance: -- cm</p>
-
-  <script>
-    const canvas = document.getElementById('radar');
-    const ctx = canvas.getContext('2d');
-    const center = 200, radius = 180;
-
-    function drawRadar(angle, distance, range) {
-      ctx.fillStyle = "black";
-      ctx.fillRect(0, 0, 400, 400);
-
-      // Range circles
-      ctx.strokeStyle = "#0f0";
-      ctx.lineWidth = 1;
-      const numCircles = 4;
-      for (let i = 1; i <= numCircles; i++) {
-        ctx.beginPath();
-        ctx.arc(center, center, (radius / numCircles) * i, 0, 2 * Math.PI);
-        ctx.stroke();
-        
-        // Range labels
-        ctx.fillStyle = "#0f0";
-        ctx.font = "10px monospace";
-        const labelDist = (range / numCircles) * i;
-        ctx.fillText(labelDist.toFixed(0), center + 5, center - (radius / numCircles) * i);
-      }
-
-      // Center point
-      ctx.fillStyle = "#0f0";
-      ctx.beginPath();
-      ctx.arc(center, center, 3, 0, 2 * Math.PI);
-      ctx.fill();
-
-      // Sweep line with gradient
-      const rad = (180 - angle) * Math.PI / 180;
-      const x = center + radius * Math.cos(rad);
-      const y = center + radius * Math.sin(rad);
-      
-      const gradient = ctx.createLinearGradient(center, center, x, y);
-      gradient.addColorStop(0, "rgba(0, 255, 0, 0.8)");
-      gradient.addColorStop(1, "rgba(0, 255, 0, 0.1)");
-      
-      ctx.strokeStyle = gradient;
-      ctx.lineWidth = 2;
-      ctx.beginPath();
-      ctx.moveTo(center, center);
-      ctx.lineTo(x, y);
-      ctx.stroke();
-
-      // Object detection
-      if (distance <= range) {
-        const objRadius = (distance / range) * radius;
-        const dx = center + objRadius * Math.cos(rad);
-        const dy = center + objRadius * Math.sin(rad);
-        
-        const isClose = distance <= (range * 0.4);
-        ctx.fillStyle = isClose ? "#f00" : "#ff0";
-        ctx.shadowBlur = isClose ? 15 : 10;
-        ctx.shadowColor = ctx.fillStyle;
-        ctx.beginPath();
-        ctx.arc(dx, dy, isClose ? 8 : 6, 0, 2 * Math.PI);
-        ctx.fill();
-        ctx.shadowBlur = 0;
-      }
-
-      // Update info
-      document.getElementById("rangeValue").innerText = range.toFixed(0);
-      const infoElement = document.getElementById("info");
-      infoElement.innerText = "Angle: " + angle + "°, Distance: " + distance.toFixed(1) + " cm";
-      
-      if (distance <= range) {
-        infoElement.className = "detecting";
-        infoElement.innerText += " - OBJECT DETECTED!";
-      } else {
-        infoElement.className = "";
-      }
+// ===== Handlers =====
+// The page is gzipped at build time and revalidated by ETag, so a
+// reconnecting client usually gets a bodyless 304.
+void handleRoot(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  response.addHeader("ETag", WEB_INDEX_ETAG);
+  response.addHeader("Cache-Control", "no-cache");
+  if (request.headerEquals("If-None-Match", WEB_INDEX_ETAG)) {
+    response.sendEmpty(304);
+    return;
+  }
+  response.addHeader("Content-Encoding", "gzip");
+  response.sendStatic(200, "text/html", WEB_INDEX_GZ, WEB_INDEX_GZ_LEN);
+}
+
+// JSON is written straight into the connection's response buffer; no
+// String temporaries, no heap.
+void sendJson(HttpResponse& response, const JsonWriter& json) {
+  if (json.overflowed()) {
+    response.send(500, "text/plain", "Response too large\n");
+    return;
+  }
+  response.send(200, "application/json", json.length());
+}
+
+void handleData(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  JsonWriter json(response.body(), response.bodyCapacity());
+  writeSampleJson(json, latestSample, detectionLimit);
+  sendJson(response, json);
+}
+
+// ===== Sensor task =====
+// Servo, ultrasonic and detection logic, in the portable ScanController.
+// Never touches Wi-Fi, I2C or the UART, so its period depends only on the
+// servo and the echoes. Results leave through lock-free queues.
+class SensorListener : public ScanListener {
+public:
+  void onSample(const RadarSample& sample, uint32_t timeMs) override;
+  void onMove(const MoveTiming& move) override {
+    if (LOG_TIMING_LEVEL >= LOG_LEVEL_DEBUG) moveLogQueue.push(move);
+  }
+  void onSweep(const SweepTiming& sweep) override {
+    sweepPeriod.record(sweep.durationMs);
+    sweepLogQueue.push(sweep);
+    sensorSweepMaxLateUs = sensorMaxLateUs;
+    sensorMaxLateUs = 0;
+  }
+};
+
+SensorListener sensorListener;
+ScanController scan(SCAN, RANGE_FILTER, SERVO_MOTION, halClock, radarServo, echoCapture, sensorListener);
+
+void publishTelemetry(const RadarSample& sample, uint32_t timeMs) {
+  TelemetrySample frame;
+  frame.reading = readingCount;
+  frame.timeMs = timeMs;
+  frame.angle = sample.angle;
+  frame.detecting = sample.detecting;
+  frame.distanceMm = (uint16_t)(sample.distance * 10 + 0.5f);
+  frame.rangeMm = (uint16_t)(sample.range * 10 + 0.5f);
+  frame.pings = scan.readingPings();
+  for (uint8_t i = 0; i < frame.pings; i++) {
+    uint32_t echoUs = scan.readingEchoUs(i);
+    frame.echoUs[i] = (echoUs == 0 || echoUs >= TELEMETRY_NO_ECHO) ? TELEMETRY_NO_ECHO : echoUs;
+  }
+  telemetryQueue.push(frame);  // A full queue shows up as a gap in `reading`
+}
+
+void SensorListener::onSample(const RadarSample& sample, uint32_t timeMs) {
+  readingPeriod.mark(timeMs);
+  scanFrame.update(sample.angle, sample.distance, timeMs, scan.sweep());
+  occupancy.update(sample.angle, sample.distance, listenRangeCm(sample.range), timeMs);
+  if (!networkQueue.push(sample)) droppedSamples++;
+  if (!uiQueue.push(sample)) droppedSamples++;
+  if (telemetryBinary) publishTelemetry(sample, timeMs);
+  readingCount++;
+}
+
+void sensorTask(void* param) {
+  for (;;) {
+    scan.setLimit(detectionLimit);
+    uint32_t waitMs = scan.poll();
+    if (waitMs == 0) continue;
+
+    uint32_t dueUs = micros() + waitMs * 1000;
+    vTaskDelay(pdMS_TO_TICKS(waitMs));
+    int32_t lateUs = (int32_t)(micros() - dueUs);
+    if (lateUs < 0) lateUs = 0;  // Tick rounding can end a delay early
+    sensorWakeups = sensorWakeups + 1;
+    sensorLateUs = sensorLateUs + lateUs;
+    if ((uint32_t)lateUs > sensorMaxLateUs) sensorMaxLateUs = lateUs;
+  }
+}
+
+// Whole scan frame in one response
+void handleScan(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  JsonWriter json(response.body(), response.bodyCapacity());
+  writeScanJson(json, scanFrame, scan.sweep(), millis(), detectionLimit);
+  sendJson(response, json);
+}
+
+// Prometheus scrape, written in place from live counters
+void handleMetrics(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  MetricsWriter metrics(response.body(), response.bodyCapacity());
+  writeScanMetrics(metrics, scan, echoCapture.stats());
+  writePeriodMetrics(metrics, "reading", readingPeriod);
+  writePeriodMetrics(metrics, "sweep", sweepPeriod);
+  metrics.counter("radar_sensor_wakeups_total", "Sensor task sleeps.", sensorWakeups)
+      .counter("radar_sensor_late_seconds_total", "Sensor wake lateness.", sensorLateUs, 6)
+      .gauge("radar_sensor_late_max_seconds", "Worst wake in last sweep.", sensorSweepMaxLateUs, 6)
+      .counter("radar_samples_dropped_total", "Samples a full queue refused.", droppedSamples)
+      .counter("radar_log_dropped_total", "Log lines lost.", logRing.dropped())
+      .counter("radar_http_requests_total", "HTTP requests served.", server.requestsServed())
+      .gauge("radar_websocket_clients", "WebSocket clients.", webSocket.connectedClients())
+      .gauge("radar_heap_free_bytes", "Free heap.", ESP.getFreeHeap())
+      .gauge("radar_heap_min_free_bytes", "Lowest free heap.", ESP.getMinFreeHeap())
+      .gauge("radar_uptime_seconds", "Since boot.", millis(), 3);
+  if (metrics.overflowed()) {
+    response.send(500, "text/plain", "Response too large\n");
+    return;
+  }
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, MetricsWriter::CONTENT_TYPE, metrics.length());
+}
+
+// Occupancy grid as a binary blob, see OccupancyGrid::writeBlob()
+void handleGrid(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  size_t len = occupancy.writeBlob((uint8_t*)response.body(), response.bodyCapacity());
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, "application/octet-stream", len);
+}
+
+void handleTrace(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  size_t len = traceDump((uint8_t*)response.body(), response.bodyCapacity());
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, "application/octet-stream", len);
+}
+
+void handleProfile(const HttpRequest& request, HttpResponse& response) {
+  PROFILE_SCOPE(httpStage);
+  size_t len = profileReport(response.body(), response.bodyCapacity());
+  if (strcmp(request.query(), "reset") == 0) ProfileStage::resetAll();
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, "text/plain", len);
+}
+
+// ===== Network task =====
+// Each sample is serialized once and the same buffer is sent to every
+// connected WebSocket client.
+void broadcastSample(const RadarSample& sample) {
+  if (!network.hasSubscribers()) return;
+  PROFILE_SCOPE(broadcastStage);
+  char buffer[80];
+  JsonWriter json(buffer, sizeof(buffer));
+  writeSampleJson(json, sample, sample.range);
+  network.broadcast(buffer, json.length());
+}
+
+void networkTask(void* param) {
+  for (;;) {
+    RadarSample sample;
+    while (networkQueue.pop(sample)) {
+      latestSample = sample;
+      broadcastSample(sample);
     }
 
-    async function updateRadar() {
-      try {
-        const res = await fetch("/data");
-        const d = await res.json();
-        drawRadar(d.angle, d.distance, d.range);
-      } catch(e) {
-        console.error("Update failed:", e);
-      }
+    network.poll(2);
+  }
+}
+
+// ===== UI task =====
+// LCD, buzzer, LED and encoder. Runs at the lowest priority; a slow
+// I2C transfer here only delays the display. Each duty is a job on
+// uiScheduler with its own period, and the task sleeps until the next
+// one is due. setup() may arm jobs before the task starts.
+const uint32_t BUTTON_POLL_MS = 5;
+const uint32_t ENCODER_POLL_MS = 10;
+const uint32_t UI_DRAIN_MS = 10;      // Samples and timing logs from the sensor task
+const uint32_t SLA_REPORT_MS = 1000;
+
+Scheduler uiScheduler;
+RadarSample uiSample;        // Last sample shown
+bool uiHaveSample = false;
+bool wasDetecting = false;
+
+// Overlay: a short-lived message that replaces the status screen until
+// a one-shot job puts the status back, instead of a delay()
+bool overlayActive = false;
+
+void expireOverlay(uint32_t nowMs) {
+  overlayActive = false;
+  if (uiHaveSample) drawStatus(lcdFrame, uiSample);
+  else lcdFrame.clear();
+}
+
+OneShotJob overlayExpiry(expireOverlay);
+
+// Whatever is in lcdFrame stays up for duration
+void holdOverlay(unsigned long duration) {
+  overlayActive = true;
+  uiScheduler.schedule(overlayExpiry, millis(), duration);
+}
+
+void showOverlay(const char* title, float limit, unsigned long duration) {
+  lcdFrame.printLine(0, "%s", title);
+  lcdFrame.printLine(1, "%d cm", (int)(limit + 0.5f));
+  holdOverlay(duration);
+}
+
+// Check for encoder button press (optional reset to default). Debounced
+// by time; holding the button does nothing more until it is released.
+bool buttonRaw = false;
+bool buttonDown = false;
+unsigned long buttonChangedAt = 0;
+
+void checkResetButton(uint32_t nowMs) {
+  bool pressed = digitalRead(ENCODER_SW) == LOW;
+  if (pressed != buttonRaw) {
+    buttonRaw = pressed;
+    buttonChangedAt = nowMs;
+  }
+  if (pressed == buttonDown || nowMs - buttonChangedAt < BUTTON_DEBOUNCE) return;
+
+  buttonDown = pressed;
+  if (!pressed) return;
+
+  detectionLimit = MIN_DETECTION_LIMIT;
+  pollEncoder();
+  lastEncoderPos = encoderPos;
+  showOverlay("Range Reset", MIN_DETECTION_LIMIT, RESET_OVERLAY_MS);
+}
+
+void showSample(const RadarSample& sample) {
+  int distanceTenths = tenths(sample.distance);
+  int rangeTenths = tenths(sample.range);
+  LOG_INFO(SCAN, "Angle: %d°, Distance: %d.%d cm, Limit: %d.%d cm", sample.angle,
+           distanceTenths / 10, distanceTenths % 10, rangeTenths / 10, rangeTenths % 10);
+
+  bool changed = sample.detecting != wasDetecting;
+  if (changed) {
+    outputs.setAlarm(sample.detecting);
+    if (sample.detecting) LOG_INFO(SCAN, ">>> OBJECT DETECTED - SERVO STOPPED <<<");
+  }
+  wasDetecting = sample.detecting;
+  uiSample = sample;
+  uiHaveSample = true;
+
+  if (!overlayActive) drawStatus(lcdFrame, sample);
+}
+
+void drainSensorQueues(uint32_t nowMs) {
+  RadarSample sample;
+  while (uiQueue.pop(sample)) showSample(sample);
+
+  MoveTiming move;
+  while (moveLogQueue.pop(move)) {
+    LOG_DEBUG(TIMING, "Move %d->%d: wait %u ms, done %u ms%s", move.from, move.to,
+              move.waitMs, move.elapsedMs, move.reversal ? " (reversal)" : "");
+  }
+
+  SweepTiming sweep;
+  while (sweepLogQueue.pop(sweep)) {
+    LOG_INFO(TIMING, "Sweep %u: %u ms, %d moves, %u ms settling", (unsigned)sweep.sweep,
+             (unsigned)sweep.durationMs, sweep.moves, (unsigned)sweep.settleMs);
+    unsigned savedTenthsMs = (sweep.echo.gatedSavedUs + 50) / 100;
+    LOG_INFO(TIMING, "  %u pings, %u timed out, %u.%u ms saved by range gate",
+             (unsigned)sweep.echo.pings, (unsigned)sweep.echo.timeouts, savedTenthsMs / 10,
+             savedTenthsMs % 10);
+  }
+}
+
+// One line per batch of misses since the last check
+void reportSlaMisses(const char* what, const PeriodMonitor& monitor, uint32_t& reported) {
+  uint32_t violations = monitor.violations();
+  if (violations == reported) return;
+  LOG_WARN(TIMING, "%s period %u ms over the %u ms limit (%u misses)", what,
+           (unsigned)monitor.lastMs(), (unsigned)monitor.limitMs(), (unsigned)violations);
+  reported = violations;
+}
+
+void reportSla(uint32_t nowMs) {
+  static uint32_t readingMisses = 0;
+  static uint32_t sweepMisses = 0;
+  reportSlaMisses("Reading", readingPeriod, readingMisses);
+  reportSlaMisses("Sweep", sweepPeriod, sweepMisses);
+}
+
+void publishIfDirty(uint32_t nowMs) {
+  if (lcdFrame.dirty()) publishScreen();
+}
+
+PeriodicJob buttonJob(checkResetButton, BUTTON_POLL_MS);
+PeriodicJob encoderJob(updateDetectionLimit, ENCODER_POLL_MS);
+PeriodicJob drainJob(drainSensorQueues, UI_DRAIN_MS);
+PeriodicJob slaJob(reportSla, SLA_REPORT_MS);
+PeriodicJob publishJob(publishIfDirty, LCD_REFRESH_MS);
+
+void uiTask(void* param) {
+  uint32_t now = millis();
+  uiScheduler.schedule(buttonJob, now);
+  uiScheduler.schedule(encoderJob, now);
+  uiScheduler.schedule(drainJob, now);
+  uiScheduler.schedule(slaJob, now, SLA_REPORT_MS);
+  uiScheduler.schedule(publishJob, now);
+
+  for (;;) {
+    uint32_t waitMs = uiScheduler.run(millis());
+    if (waitMs > 0) vTaskDelay(pdMS_TO_TICKS(waitMs));
+  }
+}
+
+// ===== LCD Task =====
+// Sole owner of the I2C bus after setup(). Blocking transfers here never
+// hold up the UI task's button and knob handling.
+void lcdTask(void* param) {
+  static LcdFrame shown;
+  static Pcf8574LcdSink sink(LCD_ADDRESS, lcdI2cWrite);
+  shown.invalidate();
+
+  for (;;) {
+    LcdScreen screen;
+    if (lcdMailbox.take(screen)) {
+      PROFILE_SCOPE(lcdStage);
+      shown.load(screen);
+      shown.flush(sink);
+      sink.flush();
     }
+    vTaskDelay(pdMS_TO_TICKS(LCD_REFRESH_MS));
+  }
+}
 
-    setInterval(updateRadar, 200);
-  </script>
-</body>
-</html>
-)rawliteral";
+// ===== Serial task =====
+// The only user of Serial after setup(). Blocks on the UART so nothing
+// else has to; lines lost to a full ring are reported as a count.
+TelemetryEncoder telemetryEncoder;
 
-// ===== Handlers =====
-void handleRoot() {
-  server.send_P(200, "text/html", MAIN_page);
+void writeLogLine(const LogRecord& record) {
+  if (telemetryBinary) {
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t len = telemetryEncoder.encodeLog(record.timeMs, record.level, record.module, record.text, frame);
+    Serial.write(frame, len);
+    return;
+  }
+
+  char line[LOG_LINE_MAX + 32];
+  int len = snprintf(line, sizeof(line), "%lu %c %s: %s\n", (unsigned long)record.timeMs,
+                     LogRing::levelChar(record.level), record.module, record.text);
+  if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+  if (len > 0) Serial.write((const uint8_t*)line, len);
+}
+
+// Profile tables go out only in text mode; they are not log lines
+void writeProfileReport() {
+  static char report[1536];
+  if (telemetryBinary) return;
+  Serial.write((const uint8_t*)report, profileReport(report, sizeof(report)));
 }
 
-void handleData() {
-  String json = "{\"angle\":" + String(currentAngle) + 
-                ",\"distance\":" + String(lastDistance, 1) + 
-                ",\"range\":" + String(detectionLimit, 1) + "}";
-  server.send(200, "application/json", json);
+void serialTask(void* param) {
+  uint32_t reportedDrops = 0;
+
+  for (;;) {
+    while (Serial.available() > 0) {
+      int command = Serial.read();
+      if (command == 'b') telemetryBinary = true;
+      else if (command == 't') telemetryBinary = false;
+      else if (command == 'p') writeProfileReport();
+    }
+
+    LogRecord record;
+    while (logRing.pop(record)) {
+      PROFILE_SCOPE(logStage);
+      writeLogLine(record);
+    }
+
+    TelemetrySample sample;
+    while (telemetryQueue.pop(sample)) {
+      if (!telemetryBinary) continue;  // Queued just before switching to text
+      uint8_t frame[TELEMETRY_MAX_FRAME];
+      Serial.write(frame, telemetryEncoder.encodeSample(sample, frame));
+    }
+
+    uint32_t drops = logRing.dropped();
+    if (drops != reportedDrops) {
+      LogRecord note = { (uint32_t)millis(), LOG_LEVEL_WARN, "LOG", "" };
+      snprintf(note.text, sizeof(note.text), "%u log lines dropped", (unsigned)(drops - reportedDrops));
+      writeLogLine(note);
+      reportedDrops = drops;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
 }
 
 // ===== Setup =====
 void setup() {
-  Serial.begin(9600);
+  Serial.begin(LOG_BAUD);
+  xTaskCreatePinnedToCore(serialTask, "serial", 4096, NULL, SERIAL_PRIORITY, NULL, SERIAL_CORE);
 
   lcd.init();
   lcd.backlight();
-  lcd.setCursor(0, 0);
-  lcd.print("ESP32 Radar Ready");
-  lcd.setCursor(0, 1);
-  lcd.print("Initializing...");
-  delay(1500);
   lcd.clear();
+  Wire.setClock(LCD_I2C_CLOCK);
+  xTaskCreatePinnedToCore(lcdTask, "lcd", 2048, NULL, LCD_PRIORITY, NULL, LCD_CORE);
+
+  // Stays up while the peripherals and Wi-Fi come up
+  lcdFrame.printLine(0, "ESP32 Radar Ready");
+  lcdFrame.printLine(1, "Initializing...");
+  publishScreen();
 
   // Pin setup
   pinMode(TRIG_PIN, OUTPUT);
   pinMode(ECHO_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ECHO_PIN), onEchoEdge, CHANGE);
   pinMode(LED_PIN, OUTPUT);
   pinMode(BUZZER_PIN, OUTPUT);
   
@@ -309,114 +778,45 @@ void setup() {
   pinMode(ENCODER_DT, INPUT_PULLUP);
   pinMode(ENCODER_SW, INPUT_PULLUP);
   
-  attachInterrupt(digitalPinToInterrupt(ENCODER_CLK), readEncoder, CHANGE);
+  setupEncoder();
   
-  digitalWrite(LED_PIN, LOW);
-  digitalWrite(BUZZER_PIN, LOW);
+  outputs.setAlarm(false);
   
   // Servo setup
   radarServo.attach(SERVO_PIN);
-  radarServo.write(currentAngle);
+  radarServo.write(scan.angle());
   
   // WiFi setup
   WiFi.softAP(ssid, password);
-  Serial.print("AP IP: ");
-  Serial.println(WiFi.softAPIP());
-  
-  lcd.setCursor(0, 0);
-  lcd.print("IP:");
-  lcd.setCursor(0, 1);
-  lcd.print(WiFi.softAPIP());
-  delay(2000);
-  lcd.clear();
+  IPAddress ip = WiFi.softAPIP();
+  LOG_INFO(SYS, "AP IP: %d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+  lcdFrame.printLine(0, "IP:");
+  lcdFrame.printLine(1, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+  publishScreen();
+  holdOverlay(IP_SCREEN_MS);  // Scanning starts underneath
   
   // Web server setup
   server.on("/", handleRoot);
   server.on("/data", handleData);
-  server.begin();
-  
-  Serial.println("Server ready");
-  Serial.printf("Initial detection range: %.1f cm\n", detectionLimit);
+  server.on("/scan", handleScan);
+  server.on("/grid", handleGrid);
+  server.on("/profile", handleProfile);
+  server.on("/metrics", handleMetrics);
+  server.on("/trace", handleTrace);
+  if (server.begin()) LOG_INFO(SYS, "Server ready");
+  else LOG_ERROR(SYS, "HTTP server failed to listen on port 80");
+  webSocket.begin();
+
+  int rangeTenths = tenths(detectionLimit);
+  LOG_INFO(SYS, "Initial detection range: %d.%d cm", rangeTenths / 10, rangeTenths % 10);
+
+  xTaskCreatePinnedToCore(sensorTask, "sensor", 4096, NULL, SENSOR_PRIORITY, NULL, SENSOR_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", 8192, NULL, NETWORK_PRIORITY, NULL, NETWORK_CORE);
+  xTaskCreatePinnedToCore(uiTask, "ui", 4096, NULL, UI_PRIORITY, NULL, UI_CORE);
 }
 
 // ===== Loop =====
+// All work happens in the pinned tasks started by setup()
 void loop() {
-  server.handleClient();
-  
-  // Check for encoder button press (optional reset to default)
-  if (digitalRead(ENCODER_SW) == LOW) {
-    delay(50);  // Debounce
-    if (digitalRead(ENCODER_SW) == LOW) {
-      detectionLimit = MIN_DETECTION_LIMIT;
-      encoderPos = 0;
-      lastEncoderPos = 0;
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.print("Range Reset");
-      lcd.setCursor(0, 1);
-      lcd.print(String(detectionLimit, 0) + " cm");
-      delay(1000);
-      lcd.clear();
-      while(digitalRead(ENCODER_SW) == LOW);  // Wait for release
-    }
-  }
-  
-  // Update detection limit from encoder
-  updateDetectionLimit();
-  
-  // Move servo to next position
-  radarServo.write(currentAngle);
-  delay(SCAN_DELAY);
-  
-  // Measure distance at this angle
-  lastDistance = getDistance();
-  Serial.printf("Angle: %d°, Distance: %.1f cm, Limit: %.1f cm\n", 
-                currentAngle, lastDistance, detectionLimit);
-  
-  // Object detection logic
-  if (lastDistance <= detectionLimit) {
-    if (!isDetecting) {
-      digitalWrite(LED_PIN, HIGH);
-      digitalWrite(BUZZER_PIN, HIGH);
-      isDetecting = true;
-
-      lcd.clear();
-      lcd.setCursor(0, 0);
-      lcd.print("Object Detected!");
-      lcd.setCursor(0, 1);
-      lcd.print(String(lastDistance, 1) + "cm @" + String(currentAngle) + "deg");
-      
-      Serial.println(">>> OBJECT DETECTED - SERVO STOPPED <<<");
-    }
-    delay(100);
-    return;
-  } else {
-    if (isDetecting) {
-      digitalWrite(LED_PIN, LOW);
-      digitalWrite(BUZZER_PIN, LOW);
-      isDetecting = false;
-      lcd.clear();
-    }
-    
-    // Normal scanning display
-    lcd.setCursor(0, 0);
-    lcd.print("Scan:" + String(currentAngle) + "deg ");
-    lcd.setCursor(0, 1);
-    lcd.print("R:" + String(detectionLimit, 0) + " D:" + String(lastDistance, 0) + "  ");
-  }
-
-  // Calculate next angle (only runs when NO object detected)
-  if (movingForward) {
-    currentAngle += SCAN_STEP;
-    if (currentAngle >= 180) {
-      currentAngle = 180;
-      movingForward = false;
-    }
-  } else {
-    currentAngle -= SCAN_STEP;
-    if (currentAngle <= 0) {
-      currentAngle = 0;
-      movingForward = true;
-    }
-  }
-}
\ No newline at end of file
+  vTaskDelete(NULL);
+}
@@ -0,0 +1,43 @@
+#include "LinuxHal.h"
+
+#include <string.h>
+
+uint64_t LinuxClock::elapsedUs() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count();
+}
+
+void LinuxOutputs::setAlarm(bool on) {
+  if (on != alarm_) printf("[alarm] %s\n", on ? "on" : "off");
+  alarm_ = on;
+}
+
+void LinuxSensor::trigger(uint32_t nowUs) {
+  float cm = sim_.ping(servo_.angle(), clock_.millis()).measuredCm;
+  uint32_t echoUs = cm > 0 ? (uint32_t)(cm * 2 / 0.0343f) : SimulatedEchoSource::NO_ECHO;
+  if (played_ < RangeFilter::MAX_PINGS) playedUs_[played_++] = echoUs;
+  echo_.queueEchoUs(echoUs);
+  echo_.trigger(nowUs);
+}
+
+LinuxDisplay::LinuxDisplay() {
+  memset(&screen_, ' ', sizeof(screen_));
+}
+
+void LinuxDisplay::setCursor(uint8_t col, uint8_t row) {
+  col_ = col;
+  row_ = row;
+}
+
+// Like the HD44780, the cursor advances and stops mattering past the row
+void LinuxDisplay::write(const char* text, size_t len) {
+  for (size_t i = 0; i < len; i++, col_++) {
+    if (row_ < LcdFrame::ROWS && col_ < LcdFrame::COLS) screen_.cells[row_][col_] = text[i];
+  }
+  changed_ = true;
+}
+
+void LinuxDisplay::show(FILE* out) {
+  if (!changed_) return;
+  changed_ = false;
+  fprintf(out, "[lcd] |%.16s|%.16s|\n", screen_.cells[0], screen_.cells[1]);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "EchoCapture.h"
+#include "Hal.h"
+#include "HttpServer.h"
+#include "RangeFilter.h"
+#include "SimulatedEchoSource.h"
+#include "SonarSim.h"
+
+// ===== Linux HAL =====
+// Host side of lib/Hal. Time is the process's steady clock (or a
+// VirtualClock), the servo and outputs only record state, and the sensor
+// ray-casts a SonarSim scene and plays the echo back through
+// SimulatedEchoSource.
+
+class LinuxClock : public HalClock {
+public:
+  LinuxClock() : start_(std::chrono::steady_clock::now()) {}
+  uint32_t millis() override { return (uint32_t)(elapsedUs() / 1000); }
+  uint32_t micros() override { return (uint32_t)elapsedUs(); }
+
+private:
+  uint64_t elapsedUs() const;
+
+  std::chrono::steady_clock::time_point start_;
+};
+
+class LinuxServo : public HalServo {
+public:
+  void write(int angle) override { angle_ = angle; }
+  int angle() const { return angle_; }
+
+private:
+  int angle_ = 0;
+};
+
+class LinuxOutputs : public HalOutputs {
+public:
+  void setAlarm(bool on) override;
+  bool alarm() const { return alarm_; }
+
+private:
+  bool alarm_ = false;
+};
+
+// Stands where the HC-SR04 and its echo interrupt do on the device
+class LinuxSensor : public EchoSource {
+public:
+  LinuxSensor(const LinuxServo& servo, SonarSim& sim, HalClock& clock)
+      : servo_(servo), sim_(sim), clock_(clock) {}
+
+  void attach(EchoCapture& capture) { echo_.attach(capture); }
+  void trigger(uint32_t nowUs) override;
+  // Delivers due echo edges; call before every ScanController::poll()
+  void advance(uint32_t nowUs) { echo_.advance(nowUs); }
+
+  // Echo widths played since clearPlayed() (0 = none), for trace
+  // recording. Unlike the captured widths these include echoes the range
+  // gate cut off, which still keep the sensor busy.
+  uint8_t played() const { return played_; }
+  uint32_t playedUs(uint8_t ping) const { return playedUs_[ping]; }
+  void clearPlayed() { played_ = 0; }
+
+private:
+  const LinuxServo& servo_;
+  SonarSim& sim_;
+  HalClock& clock_;
+  SimulatedEchoSource echo_;
+  uint32_t playedUs_[RangeFilter::MAX_PINGS];
+  uint8_t played_ = 0;
+};
+
+// Mirrors the 16x2 panel and prints it to stdout whenever it changed
+class LinuxDisplay : public LcdSink {
+public:
+  LinuxDisplay();
+
+  void setCursor(uint8_t col, uint8_t row) override;
+  void write(const char* text, size_t len) override;
+  void show(FILE* out);
+
+private:
+  LcdScreen screen_;
+  uint8_t col_ = 0;
+  uint8_t row_ = 0;
+  bool changed_ = false;
+};
+
+// HTTP only; the page falls back to polling /data without a WebSocket
+class LinuxNetwork : public HalNetwork {
+public:
+  explicit LinuxNetwork(HttpServer& server) : server_(server) {}
+
+  bool hasSubscribers() override { return false; }
+  void broadcast(const char* text, size_t len) override {}
+  void poll(uint32_t timeoutMs) override { server_.poll(timeoutMs); }
+
+private:
+  HttpServer& server_;
+};
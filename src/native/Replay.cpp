@@ -0,0 +1,194 @@
+#include "Replay.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "EchoCapture.h"
+#include "LinuxHal.h"
+#include "RadarConfig.h"
+#include "ScanController.h"
+#include "ScanTrace.h"
+#include "SimulatedEchoSource.h"
+#include "SonarSim.h"
+#include "VirtualClock.h"
+
+namespace {
+
+const int MAX_READINGS = 1 << 20;
+
+// Hands out the recorded echoes of one reading at a time
+class ReplaySensor : public EchoSource {
+public:
+  void attach(EchoCapture& capture) { echo_.attach(capture); }
+  void advance(uint32_t nowUs) { echo_.advance(nowUs); }
+
+  void load(const TraceReading& reading) {
+    unusedPings += reading_.pings - next_;
+    reading_ = reading;
+    next_ = 0;
+  }
+
+  void trigger(uint32_t nowUs) override {
+    uint32_t echoUs = SimulatedEchoSource::NO_ECHO;
+    if (next_ < reading_.pings) echoUs = reading_.echoUs[next_++];
+    else extraPings++;  // The logic wants more pings than were recorded
+    echo_.queueEchoUs(echoUs);
+    echo_.trigger(nowUs);
+  }
+
+  uint32_t extraPings = 0;
+  uint32_t unusedPings = 0;
+
+private:
+  SimulatedEchoSource echo_;
+  TraceReading reading_ = {};
+  uint8_t next_ = 0;
+};
+
+class ReplayListener : public ScanListener {
+public:
+  void onSample(const RadarSample& sample, uint32_t timeMs) override {
+    last = sample;
+    done = true;
+  }
+  void onMove(const MoveTiming& move) override { settleMs = move.waitMs; }
+
+  RadarSample last = {};
+  uint16_t settleMs = 0;
+  bool done = false;
+};
+
+// The scan logic on a virtual clock, fed one recorded reading at a time
+class Replayer {
+public:
+  explicit Replayer(const RangeFilterConfig& filter)
+      : capture_(sensor_), scan_(SCAN, filter, SERVO_MOTION, clock_, servo_, capture_, listener_) {
+    sensor_.attach(capture_);
+  }
+
+  // Runs until the scan logic has produced the sample for this reading
+  const RadarSample& play(const TraceReading& recorded) {
+    sensor_.load(recorded);
+    scan_.setLimit(recorded.rangeCm);
+    listener_.done = false;
+    while (!listener_.done) {
+      sensor_.advance(clock_.micros());
+      uint32_t waitMs = scan_.poll();
+      if (!listener_.done) clock_.advanceMs(waitMs);
+    }
+    return listener_.last;
+  }
+
+  VirtualClock& clock() { return clock_; }
+  ReplaySensor& sensor() { return sensor_; }
+  const ScanController& scan() const { return scan_; }
+  uint16_t settleMs() const { return listener_.settleMs; }
+
+private:
+  VirtualClock clock_;
+  ReplaySensor sensor_;
+  LinuxServo servo_;
+  EchoCapture capture_;
+  ReplayListener listener_;
+  ScanController scan_;
+};
+
+// FNV-1a, so two runs can be compared at a glance
+uint32_t fnv1a(uint32_t hash, const char* text) {
+  for (; *text; text++) hash = (hash ^ (uint8_t)*text) * 16777619u;
+  return hash;
+}
+
+}  // namespace
+
+int replayTrace(const char* path, FILE* out) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return -1;
+  }
+
+  Replayer replayer(RANGE_FILTER);
+  VirtualClock& clock = replayer.clock();
+
+  fprintf(out, "reading,time_ms,angle_deg,distance_cm,range_cm,detecting,pings,period_us,settle_ms,match\n");
+  uint32_t hash = 2166136261u;
+  int readings = 0;
+  int mismatches = 0;
+  uint64_t lastUs = 0;
+  char line[256];
+
+  while (fgets(line, sizeof(line), file) != NULL && readings < MAX_READINGS) {
+    TraceReading recorded;
+    if (!parseTraceRow(line, recorded)) continue;  // Header, blank lines
+
+    const RadarSample& got = replayer.play(recorded);
+    bool match = got.angle == recorded.angle && got.detecting == recorded.detecting &&
+                 fabsf(got.distance - recorded.distanceCm) < 0.05f;
+    if (!match) mismatches++;
+
+    uint64_t nowUs = clock.nowUs();
+    char row[160];
+    snprintf(row, sizeof(row), "%d,%u,%d,%.1f,%.1f,%d,%d,%llu,%u,%d\n", readings,
+             (unsigned)clock.millis(), got.angle, got.distance, got.range, got.detecting ? 1 : 0,
+             replayer.scan().readingPings(), (unsigned long long)(nowUs - lastUs), replayer.settleMs(),
+             match ? 1 : 0);
+    fputs(row, out);
+    hash = fnv1a(hash, row);
+    lastUs = nowUs;
+    readings++;
+  }
+  fclose(file);
+  replayer.sensor().load(TraceReading());  // Count the last reading's leftovers
+
+  fprintf(stderr, "Replayed %d readings in %.3f s virtual time: %d mismatches, "
+          "%u extra pings, %u unused pings, checksum %08x\n",
+          readings, clock.nowUs() / 1e6, mismatches, (unsigned)replayer.sensor().extraPings,
+          (unsigned)replayer.sensor().unusedPings, (unsigned)hash);
+  return mismatches;
+}
+
+int benchFilters(const char* path, const SonarSim& scene, FILE* out) {
+  static const char* const MODE_NAMES[] = {"median", "trimmed", "hampel"};
+
+  fprintf(out, "mode     readings  pings/reading  extra pings  mean error cm  max error cm  scored\n");
+  for (int mode = 0; mode < 3; mode++) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+      fprintf(stderr, "Cannot open %s\n", path);
+      return -1;
+    }
+
+    RangeFilterConfig filter = RANGE_FILTER;
+    filter.mode = (FilterMode)mode;
+    Replayer replayer(filter);
+    uint32_t readings = 0;
+    uint32_t pings = 0;
+    uint32_t scored = 0;
+    double absErrorCm = 0;
+    float maxErrorCm = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), file) != NULL && readings < MAX_READINGS) {
+      TraceReading recorded;
+      if (!parseTraceRow(line, recorded)) continue;
+      const RadarSample& got = replayer.play(recorded);
+      readings++;
+      pings += replayer.scan().readingPings();
+
+      // Scored like the host build's live readings, at the recorded pose
+      float truth = scene.trueRangeCm(recorded.angle, recorded.timeMs);
+      if (truth <= 0 || truth > listenRangeCm(recorded.rangeCm)) continue;
+      float error = got.distance > truth ? got.distance - truth : truth - got.distance;
+      scored++;
+      absErrorCm += error;
+      if (error > maxErrorCm) maxErrorCm = error;
+    }
+    fclose(file);
+
+    fprintf(out, "%-8s %8u  %13.2f  %11u  %13.2f  %12.1f  %6u\n", MODE_NAMES[mode], (unsigned)readings,
+            readings ? (double)pings / readings : 0, (unsigned)replayer.sensor().extraPings,
+            scored ? absErrorCm / scored : 0, maxErrorCm, (unsigned)scored);
+  }
+  return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdio.h>
+
+class SonarSim;
+
+// ===== Trace replay =====
+// Runs the scan logic on a VirtualClock, fed from a recorded trace (see
+// ScanTrace.h) instead of a sensor: each ping gets the next recorded echo
+// of the reading in progress, and each reading uses its recorded
+// detection limit. The same trace and the same code give byte-identical
+// output, so a timing or behaviour change can be bisected by comparing
+// runs.
+//
+// Writes one CSV row per reading to out, with the period of that reading
+// in virtual microseconds and whether angle, distance and detection match
+// the trace; a summary and a checksum of the rows go to stderr. Returns
+// the number of mismatching readings, or -1 if the trace can't be read.
+int replayTrace(const char* path, FILE* out);
+
+// Replays the trace once per RangeFilter mode, with RANGE_FILTER's ping
+// counts, and writes pings per reading and the range error of each mode
+// against the scene's noise-free range (the scene the trace was recorded
+// in). Returns -1 if the trace can't be read.
+int benchFilters(const char* path, const SonarSim& scene, FILE* out);
@@ -0,0 +1,400 @@
+// Host build of the radar: the same ScanController, scan frame, JSON and
+// LCD status screen as the ESP32 firmware, running over the Linux HAL.
+// The sensor is lib/SonarSim ray-casting a 2D scene. In real time the
+// page is served at http://localhost:8080/ (polling only, there is no
+// WebSocket server here).
+//
+//   pio run -e native && .pio/build/native/program [options]
+//
+//   --port N      HTTP port (real-time mode)
+//   --range CM    detection limit
+//   --scene FILE  scene description, see SonarSim.h; default is a room
+//   --sweeps N    stop after N sweeps and print timing and accuracy
+//   --fast        virtual clock, no HTTP: runs as fast as the CPU allows
+//   --record FILE write every reading, with its raw echoes, as a trace
+//   --replay FILE run the scan logic on a trace instead of the simulator
+//                 and print per-reading results (see Replay.h)
+//   --bench-filters FILE
+//                 replay a trace once per range filter mode and print
+//                 pings per reading and range error against the scene
+//   --profile     print the stage timing table (lib/Profiler) at the end;
+//                 also served at /profile. With --fast, stages and the
+//                 trace run on the virtual clock: waits such as
+//                 scan.settle show their simulated length, CPU work 0
+//   --trace FILE  write the stage trace ring at the end, for
+//                 tools/trace_to_chrome; the newest events are at /trace
+//
+// --fast --sweeps 1000 compares scan, filter and detection changes over
+// thousands of sweeps in seconds. A trace recorded once (or decoded from
+// a device capture by tools/telemetry_decode) replays identically until
+// the scan logic changes.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "EchoCapture.h"
+#include "HttpServer.h"
+#include "JsonWriter.h"
+#include "LcdFrame.h"
+#include "LinuxHal.h"
+#include "OccupancyGrid.h"
+#include "PeriodMonitor.h"
+#include "MetricsWriter.h"
+#include "Profiler.h"
+#include "RadarConfig.h"
+#include "Replay.h"
+#include "ScanController.h"
+#include "ScanFrame.h"
+#include "ScanTrace.h"
+#include "ScanView.h"
+#include "Scheduler.h"
+#include "SonarSim.h"
+#include "Trace.h"
+#include "VirtualClock.h"
+#include "web_index.h"  // Generated from web/index.html by scripts/embed_web.py
+
+// 6 x 3 m room with the sensor in the middle of one long wall, a post,
+// and someone walking across 80 cm out every 10 s
+const char* const DEFAULT_SCENE[] = {
+  "wall -300 0 -300 300",
+  "wall -300 300 300 300",
+  "wall 300 300 300 0",
+  "object -80 120 10",
+  "mover 200 80 -200 80 15 10",
+};
+
+LinuxClock realClock;
+VirtualClock virtualClock;
+bool fast = false;
+
+// Forwards to whichever clock was chosen on the command line
+class HostClock : public HalClock {
+public:
+  uint32_t millis() override { return fast ? virtualClock.millis() : realClock.millis(); }
+  uint32_t micros() override { return fast ? virtualClock.micros() : realClock.micros(); }
+};
+
+HostClock halClock;
+SonarSim sim;
+LinuxServo radarServo;
+LinuxSensor sensor(radarServo, sim, halClock);
+EchoCapture echoCapture(sensor);
+LinuxOutputs outputs;
+LinuxDisplay display;
+
+LcdFrame lcdFrame;
+ScanFrame<SCAN_STEP> scanFrame;
+OccupancyGrid<SCAN_STEP, GRID_RANGE_BINS, GRID_CELL_CM> occupancy(OCCUPANCY);
+float detectionLimit = 100;
+RadarSample latestSample = { 0, 0, 100, false };
+uint32_t sweepsLeft = 0;  // 0 runs forever
+FILE* traceFile = NULL;
+
+// Readings scored against the scene's noise-free range
+struct Accuracy {
+  uint32_t readings;
+  uint32_t scored;          // Truth inside the listening gate
+  double absErrorCm;
+  float maxErrorCm;
+  uint32_t truePositives;
+  uint32_t falsePositives;
+  uint32_t falseNegatives;
+};
+Accuracy accuracy = {};
+PeriodMonitor readingPeriod(READING_PERIOD_LIMIT_MS);
+PeriodMonitor sweepPeriod(SWEEP_PERIOD_LIMIT_MS);
+
+class HostListener : public ScanListener {
+public:
+  void onSample(const RadarSample& sample, uint32_t timeMs) override;
+  void onSweep(const SweepTiming& sweep) override {
+    printf("Sweep %u: %u ms, %d moves, %u ms settling, %u pings, %u timed out\n",
+           (unsigned)sweep.sweep, (unsigned)sweep.durationMs, sweep.moves,
+           (unsigned)sweep.settleMs, (unsigned)sweep.echo.pings, (unsigned)sweep.echo.timeouts);
+    sweepPeriod.record(sweep.durationMs);
+    if (sweepsLeft > 0) sweepsLeft--;
+  }
+};
+
+HostListener listener;
+ScanController scan(SCAN, RANGE_FILTER, SERVO_MOTION, halClock, radarServo, echoCapture, listener);
+
+// The simulator plays any echoes due, then the scan takes its turn
+class ScanJob : public SchedJob {
+public:
+  uint32_t run(uint32_t nowMs) override {
+    sensor.advance(halClock.micros());
+    return scan.poll();
+  }
+};
+
+ScanJob scanJob;
+
+void scoreSample(const RadarSample& sample, uint32_t timeMs) {
+  float truth = sim.trueRangeCm(sample.angle, timeMs);
+  bool present = truth > 0 && truth <= sample.range;
+  accuracy.readings++;
+  if (sample.detecting && present) accuracy.truePositives++;
+  if (sample.detecting && !present) accuracy.falsePositives++;
+  if (!sample.detecting && present) accuracy.falseNegatives++;
+
+  if (truth <= 0 || truth > listenRangeCm(sample.range)) return;
+  float error = sample.distance > truth ? sample.distance - truth : truth - sample.distance;
+  accuracy.scored++;
+  accuracy.absErrorCm += error;
+  if (error > accuracy.maxErrorCm) accuracy.maxErrorCm = error;
+}
+
+void recordSample(const RadarSample& sample, uint32_t timeMs) {
+  static uint32_t readings = 0;
+  TraceReading reading = {};
+  reading.reading = readings;
+  reading.timeMs = timeMs;
+  reading.angle = sample.angle;
+  reading.distanceCm = sample.distance;
+  reading.rangeCm = sample.range;
+  reading.detecting = sample.detecting;
+  reading.pings = sensor.played();
+  for (uint8_t i = 0; i < reading.pings; i++) reading.echoUs[i] = sensor.playedUs(i);
+  sensor.clearPlayed();
+
+  char row[160];
+  formatTraceRow(row, sizeof(row), readings, reading);
+  fprintf(traceFile, "%s\n", row);
+  readings++;
+}
+
+void HostListener::onSample(const RadarSample& sample, uint32_t timeMs) {
+  scanFrame.update(sample.angle, sample.distance, timeMs, scan.sweep());
+  occupancy.update(sample.angle, sample.distance, listenRangeCm(sample.range), timeMs);
+  latestSample = sample;
+  readingPeriod.mark(timeMs);
+  scoreSample(sample, timeMs);
+  if (traceFile != NULL) recordSample(sample, timeMs);
+  if (fast) return;
+
+  outputs.setAlarm(sample.detecting);
+  drawStatus(lcdFrame, sample);
+  lcdFrame.flush(display);
+  display.show(stdout);
+}
+
+void printPeriod(const char* what, const PeriodMonitor& monitor) {
+  if (monitor.periods() == 0) return;
+  printf("%s period: mean %u ms, worst %u ms, %u of %u over the %u ms limit\n", what,
+         (unsigned)(monitor.totalMs() / monitor.periods()), (unsigned)monitor.worstMs(),
+         (unsigned)monitor.violations(), (unsigned)monitor.periods(), (unsigned)monitor.limitMs());
+}
+
+void printSummary(double wallSeconds) {
+  double simSeconds = halClock.millis() / 1000.0;
+  printf("%u readings in %.1f s simulated, %.2f s wall (%.0fx real time)\n", accuracy.readings,
+         simSeconds, wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0);
+  if (accuracy.scored > 0) {
+    printf("Range error: mean %.2f cm, max %.1f cm over %u readings\n",
+           accuracy.absErrorCm / accuracy.scored, accuracy.maxErrorCm, accuracy.scored);
+  }
+  printf("Detection: %u true, %u false positives, %u missed\n", accuracy.truePositives,
+         accuracy.falsePositives, accuracy.falseNegatives);
+  printPeriod("Reading", readingPeriod);
+  printPeriod("Sweep", sweepPeriod);
+}
+
+// ===== Handlers =====
+void handleRoot(const HttpRequest& request, HttpResponse& response) {
+  response.addHeader("ETag", WEB_INDEX_ETAG);
+  response.addHeader("Cache-Control", "no-cache");
+  if (request.headerEquals("If-None-Match", WEB_INDEX_ETAG)) {
+    response.sendEmpty(304);
+    return;
+  }
+  response.addHeader("Content-Encoding", "gzip");
+  response.sendStatic(200, "text/html", WEB_INDEX_GZ, WEB_INDEX_GZ_LEN);
+}
+
+void sendJson(HttpResponse& response, const JsonWriter& json) {
+  if (json.overflowed()) {
+    response.send(500, "text/plain", "Response too large\n");
+    return;
+  }
+  response.send(200, "application/json", json.length());
+}
+
+void handleData(const HttpRequest& request, HttpResponse& response) {
+  JsonWriter json(response.body(), response.bodyCapacity());
+  writeSampleJson(json, latestSample, detectionLimit);
+  sendJson(response, json);
+}
+
+void handleScan(const HttpRequest& request, HttpResponse& response) {
+  JsonWriter json(response.body(), response.bodyCapacity());
+  writeScanJson(json, scanFrame, scan.sweep(), halClock.millis(), detectionLimit);
+  sendJson(response, json);
+}
+
+HttpServer* httpServer = nullptr;
+
+void handleMetrics(const HttpRequest& request, HttpResponse& response) {
+  MetricsWriter metrics(response.body(), response.bodyCapacity());
+  writeScanMetrics(metrics, scan, echoCapture.stats());
+  writePeriodMetrics(metrics, "reading", readingPeriod);
+  writePeriodMetrics(metrics, "sweep", sweepPeriod);
+  metrics.counter("radar_http_requests_total", "HTTP requests served.", httpServer->requestsServed())
+      .gauge("radar_uptime_seconds", "Since start.", halClock.millis(), 3);
+  if (metrics.overflowed()) {
+    response.send(500, "text/plain", "Response too large\n");
+    return;
+  }
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, MetricsWriter::CONTENT_TYPE, metrics.length());
+}
+
+// Occupancy grid as a binary blob, see OccupancyGrid::writeBlob()
+void handleGrid(const HttpRequest& request, HttpResponse& response) {
+  size_t len = occupancy.writeBlob((uint8_t*)response.body(), response.bodyCapacity());
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, "application/octet-stream", len);
+}
+
+void handleTrace(const HttpRequest& request, HttpResponse& response) {
+  size_t len = traceDump((uint8_t*)response.body(), response.bodyCapacity());
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, "application/octet-stream", len);
+}
+
+bool writeTrace(const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot create %s\n", path);
+    return false;
+  }
+  static uint8_t dump[TRACE_HEADER_SIZE + 4096 + TRACE_EVENTS * TRACE_EVENT_SIZE];
+  fwrite(dump, 1, traceDump(dump, sizeof(dump)), file);
+  fclose(file);
+  return true;
+}
+
+void handleProfile(const HttpRequest& request, HttpResponse& response) {
+  size_t len = profileReport(response.body(), response.bodyCapacity());
+  if (strcmp(request.query(), "reset") == 0) ProfileStage::resetAll();
+  response.addHeader("Cache-Control", "no-store");
+  response.send(200, "text/plain", len);
+}
+
+bool loadScene(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  char line[160];
+  int number = 0;
+  bool ok = true;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    number++;
+    if (!sim.parseLine(line)) {
+      fprintf(stderr, "%s:%d: cannot parse: %s", path, number, line);
+      ok = false;
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int port = 8080;
+  const char* scenePath = NULL;
+  const char* recordPath = NULL;
+  const char* replayPath = NULL;
+  const char* benchPath = NULL;
+  const char* tracePath = NULL;
+  bool profile = false;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--fast") == 0) fast = true;
+    else if (strcmp(argv[i], "--profile") == 0) profile = true;
+    else if (hasValue && strcmp(argv[i], "--port") == 0) port = atoi(argv[++i]);
+    else if (hasValue && strcmp(argv[i], "--range") == 0) detectionLimit = atof(argv[++i]);
+    else if (hasValue && strcmp(argv[i], "--sweeps") == 0) sweepsLeft = atoi(argv[++i]);
+    else if (hasValue && strcmp(argv[i], "--scene") == 0) scenePath = argv[++i];
+    else if (hasValue && strcmp(argv[i], "--record") == 0) recordPath = argv[++i];
+    else if (hasValue && strcmp(argv[i], "--replay") == 0) replayPath = argv[++i];
+    else if (hasValue && strcmp(argv[i], "--bench-filters") == 0) benchPath = argv[++i];
+    else if (hasValue && strcmp(argv[i], "--trace") == 0) tracePath = argv[++i];
+    else {
+      fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+  if (detectionLimit < MIN_DETECTION_LIMIT) detectionLimit = MIN_DETECTION_LIMIT;
+  if (detectionLimit > MAX_DETECTION_LIMIT) detectionLimit = MAX_DETECTION_LIMIT;
+#if PROFILING
+  // Real time would show the settle and echo waits as sub-microsecond
+  if (fast) profileClockUs = [] { return virtualClock.micros(); };
+#endif
+  setvbuf(stdout, NULL, _IOLBF, 0);  // Line by line, also into a pipe
+
+  if (replayPath != NULL) return replayTrace(replayPath, stdout) == 0 ? 0 : 1;
+  if (recordPath != NULL) {
+    traceFile = fopen(recordPath, "w");
+    if (traceFile == NULL) {
+      fprintf(stderr, "Cannot create %s\n", recordPath);
+      return 1;
+    }
+    fprintf(traceFile, "%s\n", TRACE_HEADER);
+  }
+
+  if (scenePath != NULL) {
+    if (!loadScene(scenePath)) return 1;
+  } else {
+    for (const char* line : DEFAULT_SCENE) sim.parseLine(line);
+  }
+  sim.setMaxRangeCm(MAX_DETECTION_LIMIT);
+  if (benchPath != NULL) return benchFilters(benchPath, sim, stdout) == 0 ? 0 : 1;
+
+  HttpServer server(port);
+  server.on("/", handleRoot);
+  server.on("/data", handleData);
+  server.on("/scan", handleScan);
+  server.on("/grid", handleGrid);
+  server.on("/profile", handleProfile);
+  server.on("/metrics", handleMetrics);
+  server.on("/trace", handleTrace);
+  httpServer = &server;
+  if (!fast && !server.begin()) {
+    fprintf(stderr, "Cannot listen on port %d\n", port);
+    return 1;
+  }
+  LinuxNetwork network(server);
+  if (!fast) printf("Serving on http://localhost:%d/\n", port);
+  printf("Detection range %.1f cm, %d walls, %d objects\n", detectionLimit, sim.walls(), sim.objects());
+
+  sensor.attach(echoCapture);
+  scan.setLimit(detectionLimit);
+
+  // One thread. In real time the network poll doubles as the scheduler's
+  // sleep; with --fast the virtual clock jumps straight to the next job.
+  auto start = std::chrono::steady_clock::now();
+  bool bounded = sweepsLeft > 0;
+  Scheduler scheduler(halClock.millis());
+  scheduler.schedule(scanJob, halClock.millis());
+  while (!bounded || sweepsLeft > 0) {
+    uint32_t waitMs = scheduler.run(halClock.millis());
+    if (fast) virtualClock.advanceMs(waitMs);
+    else network.poll(waitMs);
+  }
+
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+  printSummary(wall.count());
+  if (profile) {
+    char report[2048];
+    profileReport(report, sizeof(report));
+    if (fast) printf("Stage times on the virtual clock (--fast)\n");
+    printf("%s", report);
+  }
+  if (traceFile != NULL) fclose(traceFile);
+  if (tracePath != NULL && !writeTrace(tracePath)) return 1;
+  return 0;
+}
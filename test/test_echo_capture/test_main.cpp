@@ -0,0 +1,201 @@
+// EchoCapture state transitions, driven through SimulatedEchoSource:
+// echo, plain and gated timeouts, draining a high echo line, late edges
+// and micros() wraparound.
+//
+//   pio test -e native -f test_echo_capture
+
+#include <unity.h>
+
+#include "EchoCapture.h"
+#include "SimulatedEchoSource.h"
+
+static const uint32_t RESPONSE_US = 450;  // SimulatedEchoSource's default
+
+static SimulatedEchoSource* source;
+static EchoCapture* capture;
+
+void setUp() {
+  source = new SimulatedEchoSource();
+  capture = new EchoCapture(*source);
+  source->attach(*capture);
+}
+
+void tearDown() {
+  delete capture;
+  delete source;
+}
+
+static void step(uint32_t nowUs) {
+  source->advance(nowUs);
+  capture->poll(nowUs);
+}
+
+// Steps time the way the sensor task polls, edges first, ending on toUs
+static void runTo(uint32_t fromUs, uint32_t toUs, uint32_t stepUs = 100) {
+  for (uint32_t t = fromUs; (int32_t)(toUs - t) > 0; t += stepUs) step(t);
+  step(toUs);
+}
+
+void test_echo_is_timed_between_edges() {
+  TEST_ASSERT_FALSE(capture->busy());
+  source->queueEchoUs(5831);  // ~100cm
+  TEST_ASSERT_TRUE(capture->startPing(1000));
+  TEST_ASSERT_TRUE(capture->busy());
+  TEST_ASSERT_FALSE(capture->startPing(1100));  // One ping at a time
+  TEST_ASSERT_EQUAL(1, source->triggers());
+
+  EchoResult result;
+  runTo(1000, 1000 + RESPONSE_US + 5000);
+  TEST_ASSERT_TRUE(capture->busy());  // Line high, pulse still running
+  TEST_ASSERT_FALSE(capture->nextResult(result));
+
+  runTo(1000 + RESPONSE_US + 5000, 1000 + RESPONSE_US + 5831);
+  TEST_ASSERT_FALSE(capture->busy());
+  TEST_ASSERT_TRUE(capture->nextResult(result));
+  TEST_ASSERT_FALSE(result.timedOut);
+  TEST_ASSERT_EQUAL_UINT32(1000, result.pingUs);
+  TEST_ASSERT_EQUAL_UINT32(5831, result.echoUs);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 100.0f, EchoCapture::echoToCm(result.echoUs));
+  TEST_ASSERT_FALSE(capture->nextResult(result));
+
+  EchoStats stats = capture->stats();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.pings);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.timeouts);
+}
+
+void test_no_echo_times_out_then_drains() {
+  // The module holds the line high ~38ms when nothing comes back, past
+  // the 30ms timeout
+  TEST_ASSERT_TRUE(capture->startPing(0));
+  runTo(0, EchoCapture::DEFAULT_TIMEOUT_US + 100);
+
+  EchoResult result;
+  TEST_ASSERT_TRUE(capture->nextResult(result));
+  TEST_ASSERT_TRUE(result.timedOut);
+  TEST_ASSERT_EQUAL_UINT32(0, result.echoUs);
+  TEST_ASSERT_TRUE(capture->busy());  // Draining: the sensor would ignore a trigger
+  TEST_ASSERT_FALSE(capture->startPing(EchoCapture::DEFAULT_TIMEOUT_US + 200));
+
+  runTo(EchoCapture::DEFAULT_TIMEOUT_US + 200, RESPONSE_US + 38000);
+  TEST_ASSERT_FALSE(capture->busy());
+  TEST_ASSERT_FALSE(capture->nextResult(result));  // The late fall posts nothing
+  EchoStats stats = capture->stats();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.timeouts);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.gatedSavedUs);  // Ungated: nothing saved
+}
+
+void test_gated_timeout_counts_saved_time() {
+  capture->setTimeoutUs(7000);
+  source->queueEchoUs(20000);  // ~343cm, beyond the gate
+  TEST_ASSERT_TRUE(capture->startPing(0));
+  runTo(0, 7100);
+
+  EchoResult result;
+  TEST_ASSERT_TRUE(capture->nextResult(result));
+  TEST_ASSERT_TRUE(result.timedOut);
+  TEST_ASSERT_TRUE(capture->busy());
+
+  runTo(7200, RESPONSE_US + 20000);
+  TEST_ASSERT_FALSE(capture->busy());
+  EchoStats stats = capture->stats();
+  TEST_ASSERT_EQUAL_UINT32(1, stats.timeouts);
+  // pulseIn() would have returned when the line fell
+  TEST_ASSERT_EQUAL_UINT32(RESPONSE_US + 20000 - 7000, stats.gatedSavedUs);
+}
+
+void test_timeout_before_rise_goes_straight_to_idle() {
+  source->setResponseDelayUs(EchoCapture::DEFAULT_TIMEOUT_US + 5000);
+  TEST_ASSERT_TRUE(capture->startPing(0));
+  runTo(0, EchoCapture::DEFAULT_TIMEOUT_US + 100);
+
+  EchoResult result;
+  TEST_ASSERT_TRUE(capture->nextResult(result));
+  TEST_ASSERT_TRUE(result.timedOut);
+  TEST_ASSERT_FALSE(capture->busy());  // Line never went high; nothing to drain
+
+  // The stale edges of that ping are ignored while idle and by the next one
+  source->advance(EchoCapture::DEFAULT_TIMEOUT_US + 5000);
+  TEST_ASSERT_FALSE(capture->busy());
+  TEST_ASSERT_FALSE(capture->nextResult(result));
+}
+
+void test_late_fall_after_timeout_posts_once() {
+  capture->setTimeoutUs(3000);
+  TEST_ASSERT_TRUE(capture->startPing(0));
+  capture->onEdge(true, 500);
+  capture->poll(3100);  // Timeout wins the race
+  capture->onEdge(false, 3150);  // Edge that was already on its way
+
+  EchoResult result;
+  TEST_ASSERT_TRUE(capture->nextResult(result));
+  TEST_ASSERT_TRUE(result.timedOut);
+  TEST_ASSERT_FALSE(capture->nextResult(result));
+  TEST_ASSERT_FALSE(capture->busy());  // That fall ended the drain
+}
+
+void test_stuck_line_is_released_after_max_busy() {
+  source->setNoEchoPulseUs(100000);  // A line that stays high far too long
+  TEST_ASSERT_TRUE(capture->startPing(0));
+  runTo(0, EchoCapture::MAX_BUSY_US, 1000);
+  TEST_ASSERT_TRUE(capture->busy());
+  capture->poll(EchoCapture::MAX_BUSY_US + 1);
+  TEST_ASSERT_FALSE(capture->busy());
+  TEST_ASSERT_TRUE(capture->startPing(EchoCapture::MAX_BUSY_US + 2));
+}
+
+void test_edges_while_idle_are_ignored() {
+  capture->onEdge(true, 100);
+  capture->onEdge(false, 200);
+  EchoResult result;
+  TEST_ASSERT_FALSE(capture->busy());
+  TEST_ASSERT_FALSE(capture->nextResult(result));
+}
+
+void test_micros_wraparound() {
+  const uint32_t start = 0xFFFFF000;  // micros() wraps 4ms in
+  source->queueEchoUs(5000);
+  TEST_ASSERT_TRUE(capture->startPing(start));
+  runTo(start, start + RESPONSE_US + 5000);
+
+  EchoResult result;
+  TEST_ASSERT_TRUE(capture->nextResult(result));
+  TEST_ASSERT_FALSE(result.timedOut);
+  TEST_ASSERT_EQUAL_UINT32(5000, result.echoUs);
+  TEST_ASSERT_EQUAL_UINT32(start, result.pingUs);
+}
+
+void test_back_to_back_pings() {
+  const uint32_t echoes[] = {1000, SimulatedEchoSource::NO_ECHO, 3000};
+  for (uint32_t echo : echoes) source->queueEchoUs(echo);
+  capture->setTimeoutUs(10000);
+
+  uint32_t now = 0;
+  int done = 0;
+  EchoResult results[3];
+  while (done < 3 && now < 200000) {
+    if (!capture->busy()) capture->startPing(now);
+    step(now);
+    while (done < 3 && capture->nextResult(results[done])) done++;
+    now += 50;
+  }
+  TEST_ASSERT_EQUAL(3, done);
+  TEST_ASSERT_EQUAL_UINT32(1000, results[0].echoUs);
+  TEST_ASSERT_TRUE(results[1].timedOut);
+  TEST_ASSERT_EQUAL_UINT32(3000, results[2].echoUs);
+  TEST_ASSERT_EQUAL_UINT32(3, capture->stats().pings);
+  TEST_ASSERT_EQUAL_UINT32(3, source->triggers());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_echo_is_timed_between_edges);
+  RUN_TEST(test_no_echo_times_out_then_drains);
+  RUN_TEST(test_gated_timeout_counts_saved_time);
+  RUN_TEST(test_timeout_before_rise_goes_straight_to_idle);
+  RUN_TEST(test_late_fall_after_timeout_posts_once);
+  RUN_TEST(test_stuck_line_is_released_after_max_busy);
+  RUN_TEST(test_edges_while_idle_are_ignored);
+  RUN_TEST(test_micros_wraparound);
+  RUN_TEST(test_back_to_back_pings);
+  return UNITY_END();
+}
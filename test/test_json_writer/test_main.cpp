@@ -0,0 +1,215 @@
+// JsonWriter output, and a /scan body built with it against the String
+// concatenation it replaced, counting heap allocations through global
+// operator new/delete.
+//
+//   pio test -e native -f test_json_writer -v   (-v shows the benchmark)
+
+#include <unity.h>
+
+#include <chrono>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "JsonWriter.h"
+#include "ScanFrame.h"
+#include "ScanView.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+static const char* write(void (*build)(JsonWriter&), char* buffer, size_t size) {
+  JsonWriter json(buffer, size);
+  build(json);
+  TEST_ASSERT_FALSE(json.overflowed());
+  return json.c_str();
+}
+
+void test_commas_between_items_only() {
+  char buffer[128];
+  TEST_ASSERT_EQUAL_STRING("{\"a\":1,\"b\":[1,2,[],{}],\"c\":{\"d\":null}}", write([](JsonWriter& json) {
+    json.beginObject()
+        .field("a", 1)
+        .key("b").beginArray().value(1).value(2).beginArray().endArray().beginObject().endObject().endArray()
+        .key("c").beginObject().key("d").null().endObject()
+        .endObject();
+  }, buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_STRING("[]", write([](JsonWriter& json) { json.beginArray().endArray(); },
+                                       buffer, sizeof(buffer)));
+}
+
+void test_integers_and_bools() {
+  char buffer[128];
+  TEST_ASSERT_EQUAL_STRING("[0,-1,4294967295,-9223372036854775808,true,false]", write([](JsonWriter& json) {
+    json.beginArray()
+        .value(0)
+        .value(-1)
+        .value((uint32_t)UINT32_MAX)
+        .value((long long)INT64_MIN)
+        .value(true)
+        .value(false)
+        .endArray();
+  }, buffer, sizeof(buffer)));
+}
+
+void test_strings_are_escaped() {
+  char buffer[128];
+  TEST_ASSERT_EQUAL_STRING("[\"say \\\"hi\\\"\",\"a\\\\b\",\"tab\\u0009nl\\u000a\"]", write([](JsonWriter& json) {
+    json.beginArray().value("say \"hi\"").value("a\\b").value("tab\tnl\n").endArray();
+  }, buffer, sizeof(buffer)));
+  TEST_ASSERT_EQUAL_STRING("{\"q\\\"k\":\"\"}", write([](JsonWriter& json) {
+    json.beginObject().field("q\"k", "").endObject();
+  }, buffer, sizeof(buffer)));
+}
+
+void test_float_rounding() {
+  char buffer[256];
+  TEST_ASSERT_EQUAL_STRING("[1.5,-1.5,0.0,-0.1,0.0,10.0,-10.0,100,-3,0.125,null,null]", write([](JsonWriter& json) {
+    json.beginArray()
+        .value(1.45f, 1)
+        .value(-1.45f, 1)
+        .value(0.0f, 1)
+        .value(-0.06f, 1)   // Rounds away from zero, keeps its sign
+        .value(-0.04f, 1)   // Rounds to zero, loses it
+        .value(9.96f, 1)    // Carries into the integer part
+        .value(-9.96f, 1)
+        .value(99.5f, 0)
+        .value(-2.5f, 0)
+        .value(0.125f, 3)
+        .value(NAN, 1)
+        .value(1e20f, 1)
+        .endArray();
+  }, buffer, sizeof(buffer)));
+}
+
+void test_float_range_depends_on_decimals() {
+  // The guard is on the scaled value, so more decimals lower the ceiling
+  char buffer[256];
+  TEST_ASSERT_EQUAL_STRING("[null,null,1099511627776.000000,100000000376832.0,null]", write([](JsonWriter& json) {
+    json.beginArray()
+        .value(1e14f, 6)
+        .value(-1e14f, 6)
+        .value(1099511627776.0f, 6)  // 2^40, still fits with 6 decimals
+        .value(1e14f, 1)
+        .value(INFINITY, 0)
+        .endArray();
+  }, buffer, sizeof(buffer)));
+}
+
+void test_overflow_truncates_and_reports() {
+  char buffer[12];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject().field("distance", 123.4f, 1).endObject();
+  TEST_ASSERT_TRUE(json.overflowed());
+  TEST_ASSERT_EQUAL(sizeof(buffer) - 1, json.length());
+  TEST_ASSERT_EQUAL_STRING("{\"distance\"", buffer);  // Terminated, never past the end
+
+  char empty[1];
+  JsonWriter none(empty, 0);
+  TEST_ASSERT_TRUE(none.overflowed());
+}
+
+// ===== Benchmark =====
+static ScanFrame<5> frame;
+
+// The removed handleScan(): Arduino String concatenation, with String's
+// float formatting, stood in for by std::string
+static std::string decimal(float value, int decimals) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  return std::string(text);
+}
+
+static std::string stringScan(uint32_t sweep, uint32_t nowMs, float range) {
+  std::string json;
+  json.reserve(64 + frame.BINS * 24);
+  json = "{\"step\":" + std::to_string(5) + ",\"sweep\":" + std::to_string(sweep) +
+         ",\"now\":" + std::to_string(nowMs) + ",\"range\":" + decimal(range, 1) + ",\"slots\":[";
+  for (int bin = 0; bin < frame.BINS; bin++) {
+    ScanSlot slot = frame.read(bin);
+    if (bin > 0) json += ',';
+    json += '[';
+    json += decimal(slot.distance, 1);
+    json += ',';
+    json += std::to_string(slot.timestampMs);
+    json += ',';
+    json += std::to_string(slot.sweep);
+    json += ']';
+  }
+  json += "]}";
+  return json;
+}
+
+void test_scan_body_without_allocations() {
+  for (int bin = 0; bin < frame.BINS; bin++) {
+    frame.update(bin * 5, 30.0f + bin * 7.3f, 100000 + bin * 61, 42);
+  }
+  static char body[4096];
+  const int ROUNDS = 2000;
+
+  // Same bytes from both paths
+  JsonWriter check(body, sizeof(body));
+  writeScanJson(check, frame, 42, 123456, 100.0f);
+  TEST_ASSERT_FALSE(check.overflowed());
+  TEST_ASSERT_EQUAL_STRING(stringScan(42, 123456, 100.0f).c_str(), body);
+
+  size_t before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes = 0;
+  for (int i = 0; i < ROUNDS; i++) {
+    JsonWriter json(body, sizeof(body));
+    writeScanJson(json, frame, 42 + i, 123456 + i, 100.0f);
+    bytes += json.length();
+  }
+  double writerUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  size_t writerAllocs = allocations - before;
+
+  before = allocations;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUNDS; i++) bytes += stringScan(42 + i, 123456 + i, 100.0f).size();
+  double stringUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  size_t stringAllocs = allocations - before;
+
+  char report[160];
+  snprintf(report, sizeof(report),
+           "/scan body (%u bytes): JsonWriter %.2f us, %.1f allocs; String %.2f us, %.1f allocs",
+           (unsigned)check.length(), writerUs / ROUNDS, (double)writerAllocs / ROUNDS,
+           stringUs / ROUNDS, (double)stringAllocs / ROUNDS);
+  TEST_MESSAGE(report);
+
+  TEST_ASSERT_GREATER_THAN(0, bytes);
+  TEST_ASSERT_EQUAL(0, writerAllocs);
+  TEST_ASSERT_GREATER_THAN(ROUNDS, stringAllocs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_commas_between_items_only);
+  RUN_TEST(test_integers_and_bools);
+  RUN_TEST(test_strings_are_escaped);
+  RUN_TEST(test_float_rounding);
+  RUN_TEST(test_float_range_depends_on_decimals);
+  RUN_TEST(test_overflow_truncates_and_reports);
+  RUN_TEST(test_scan_body_without_allocations);
+  return UNITY_END();
+}
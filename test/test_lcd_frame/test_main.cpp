@@ -0,0 +1,158 @@
+// LcdFrame::flush() against a sink that records what it was sent: only
+// changed cells go out, short gaps are merged, runs never cross rows.
+//
+//   pio test -e native -f test_lcd_frame
+
+#include <unity.h>
+
+#include <string.h>
+
+#include "LcdFrame.h"
+
+// Records every cursor command and run, and the bytes they cost
+class CountingSink : public LcdSink {
+public:
+  static const int MAX_RUNS = 8;
+
+  struct Run {
+    uint8_t col;
+    uint8_t row;
+    char text[LcdFrame::COLS + 1];
+  };
+
+  void setCursor(uint8_t col, uint8_t row) override {
+    cursors++;
+    bytes++;
+    col_ = col;
+    row_ = row;
+  }
+
+  void write(const char* text, size_t len) override {
+    bytes += len;
+    if (runs < MAX_RUNS) {
+      Run& run = run_[runs];
+      run.col = col_;
+      run.row = row_;
+      memcpy(run.text, text, len);
+      run.text[len] = '\0';
+    }
+    runs++;
+  }
+
+  const Run& run(int i) const { return run_[i]; }
+
+  int cursors = 0;
+  int runs = 0;
+  size_t bytes = 0;
+
+private:
+  Run run_[MAX_RUNS];
+  uint8_t col_ = 0;
+  uint8_t row_ = 0;
+};
+
+static LcdFrame frame;
+static CountingSink sink;
+
+// A frame already on the display with known contents
+void setUp() {
+  frame = LcdFrame();
+  frame.printLine(0, "Angle: 90");
+  frame.printLine(1, "Dist: 123.4 cm");
+  frame.flush(sink);
+  sink = CountingSink();
+}
+
+void tearDown() {}
+
+void test_first_flush_draws_everything() {
+  LcdFrame fresh;
+  TEST_ASSERT_TRUE(fresh.dirty());
+  size_t bytes = fresh.flush(sink);
+  TEST_ASSERT_EQUAL(LcdFrame::ROWS * (1 + LcdFrame::COLS), bytes);
+  TEST_ASSERT_EQUAL(sink.bytes, bytes);
+  TEST_ASSERT_EQUAL(LcdFrame::ROWS, sink.cursors);
+  TEST_ASSERT_FALSE(fresh.dirty());
+}
+
+void test_unchanged_frame_costs_nothing() {
+  TEST_ASSERT_FALSE(frame.dirty());
+  TEST_ASSERT_EQUAL(0, frame.flush(sink));
+
+  // Redrawing the same text is not a change either
+  frame.clear();
+  frame.printLine(0, "Angle: %d", 90);
+  frame.printLine(1, "Dist: 123.4 cm");
+  TEST_ASSERT_FALSE(frame.dirty());
+  TEST_ASSERT_EQUAL(0, frame.flush(sink));
+  TEST_ASSERT_EQUAL(0, sink.cursors);
+  TEST_ASSERT_EQUAL(0, sink.runs);
+}
+
+void test_single_cell_change() {
+  frame.printLine(0, "Angle: 95");
+  TEST_ASSERT_EQUAL(2, frame.flush(sink));
+  TEST_ASSERT_EQUAL(1, sink.runs);
+  TEST_ASSERT_EQUAL(8, sink.run(0).col);
+  TEST_ASSERT_EQUAL(0, sink.run(0).row);
+  TEST_ASSERT_EQUAL_STRING("5", sink.run(0).text);
+  TEST_ASSERT_EQUAL(2, sink.bytes);
+  TEST_ASSERT_EQUAL(0, frame.flush(sink));
+}
+
+void test_one_cell_gap_is_merged() {
+  // Cells 6 and 8 change, 7 does not: resending it is cheaper than a
+  // second cursor command
+  frame.print(6, 1, "9");
+  frame.print(8, 1, "6");
+  TEST_ASSERT_EQUAL(4, frame.flush(sink));
+  TEST_ASSERT_EQUAL(1, sink.cursors);
+  TEST_ASSERT_EQUAL(6, sink.run(0).col);
+  TEST_ASSERT_EQUAL_STRING("926", sink.run(0).text);
+}
+
+void test_two_cell_gap_is_split() {
+  frame.print(6, 1, "9");
+  frame.print(9, 1, "8");
+  TEST_ASSERT_EQUAL(4, frame.flush(sink));
+  TEST_ASSERT_EQUAL(2, sink.cursors);
+  TEST_ASSERT_EQUAL(6, sink.run(0).col);
+  TEST_ASSERT_EQUAL_STRING("9", sink.run(0).text);
+  TEST_ASSERT_EQUAL(9, sink.run(1).col);
+  TEST_ASSERT_EQUAL_STRING("8", sink.run(1).text);
+}
+
+void test_changes_on_both_rows() {
+  // Last cell of row 0 and first of row 1 are adjacent in memory, but
+  // each row needs its own cursor command
+  frame.print(15, 0, "*");
+  frame.print(0, 1, "d");
+  TEST_ASSERT_EQUAL(4, frame.flush(sink));
+  TEST_ASSERT_EQUAL(2, sink.runs);
+  TEST_ASSERT_EQUAL(15, sink.run(0).col);
+  TEST_ASSERT_EQUAL(0, sink.run(0).row);
+  TEST_ASSERT_EQUAL(0, sink.run(1).col);
+  TEST_ASSERT_EQUAL(1, sink.run(1).row);
+  TEST_ASSERT_FALSE(frame.dirty());
+}
+
+void test_mark_shown_and_invalidate() {
+  frame.printLine(1, "Object detected");
+  frame.markShown();  // Another task sent it
+  TEST_ASSERT_EQUAL(0, frame.flush(sink));
+
+  frame.invalidate();
+  TEST_ASSERT_EQUAL(LcdFrame::ROWS * (1 + LcdFrame::COLS), frame.flush(sink));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_flush_draws_everything);
+  RUN_TEST(test_unchanged_frame_costs_nothing);
+  RUN_TEST(test_single_cell_change);
+  RUN_TEST(test_one_cell_gap_is_merged);
+  RUN_TEST(test_two_cell_gap_is_split);
+  RUN_TEST(test_changes_on_both_rows);
+  RUN_TEST(test_mark_shown_and_invalidate);
+  return UNITY_END();
+}
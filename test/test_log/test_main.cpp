@@ -0,0 +1,213 @@
+// LogRing: a full ring drops instead of waiting, several producer
+// threads race for cells without losing or tearing records, and lines
+// above a module's level never run.
+//
+//   pio test -e native -f test_log
+
+#include <unity.h>
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "Log.h"
+
+static unsigned long fakeMillis() {
+  return 1234;
+}
+
+LogRing logRing(fakeMillis);
+
+#define LOG_TEST_LEVEL LOG_LEVEL_WARN
+
+static void drain(LogRing& ring) {
+  LogRecord record;
+  while (ring.pop(record)) {
+  }
+}
+
+void setUp() {
+  drain(logRing);
+}
+
+void tearDown() {}
+
+void test_records_come_out_in_order() {
+  LogRing ring(fakeMillis);
+  TEST_ASSERT_TRUE(ring.write(LOG_LEVEL_INFO, "scan", "reading %d", 1));
+  TEST_ASSERT_TRUE(ring.write(LOG_LEVEL_WARN, "net", "reading %d", 2));
+
+  LogRecord record;
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL_STRING("reading 1", record.text);
+  TEST_ASSERT_EQUAL_STRING("scan", record.module);
+  TEST_ASSERT_EQUAL(LOG_LEVEL_INFO, record.level);
+  TEST_ASSERT_EQUAL_UINT32(1234, record.timeMs);
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL_STRING("reading 2", record.text);
+  TEST_ASSERT_FALSE(ring.pop(record));
+}
+
+void test_long_lines_are_cut() {
+  LogRing ring(nullptr);
+  char longLine[LOG_LINE_MAX * 2];
+  memset(longLine, 'x', sizeof(longLine) - 1);
+  longLine[sizeof(longLine) - 1] = '\0';
+  TEST_ASSERT_TRUE(ring.write(LOG_LEVEL_INFO, "ui", "%s", longLine));
+
+  LogRecord record;
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL(LOG_LINE_MAX - 1, strlen(record.text));
+  TEST_ASSERT_EQUAL_UINT32(0, record.timeMs);
+}
+
+void test_full_ring_drops_without_waiting() {
+  LogRing ring(fakeMillis);
+  for (int i = 0; i < LOG_RING_SIZE; i++) TEST_ASSERT_TRUE(ring.write(LOG_LEVEL_INFO, "scan", "%d", i));
+  TEST_ASSERT_EQUAL_UINT32(0, ring.dropped());
+
+  // No consumer: writes fail straight away and are counted
+  for (int i = 0; i < 3; i++) TEST_ASSERT_FALSE(ring.write(LOG_LEVEL_INFO, "scan", "lost %d", i));
+  TEST_ASSERT_EQUAL_UINT32(3, ring.dropped());
+  TEST_ASSERT_EQUAL_UINT32(LOG_RING_SIZE, ring.written());
+
+  // One pop frees one cell; the survivors are the first ones written
+  LogRecord record;
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL_STRING("0", record.text);
+  TEST_ASSERT_TRUE(ring.write(LOG_LEVEL_INFO, "scan", "late"));
+  TEST_ASSERT_FALSE(ring.write(LOG_LEVEL_INFO, "scan", "lost"));
+  TEST_ASSERT_EQUAL_UINT32(4, ring.dropped());
+
+  for (int i = 1; i < LOG_RING_SIZE; i++) {
+    TEST_ASSERT_TRUE(ring.pop(record));
+    char expected[8];
+    snprintf(expected, sizeof(expected), "%d", i);
+    TEST_ASSERT_EQUAL_STRING(expected, record.text);
+  }
+  TEST_ASSERT_TRUE(ring.pop(record));
+  TEST_ASSERT_EQUAL_STRING("late", record.text);
+  TEST_ASSERT_FALSE(ring.pop(record));
+}
+
+// Producers tag each line with their id and a counter; consumers check
+// that every line arrives whole, once, and in order per producer
+static void race(int consumers) {
+  const int PRODUCERS = 4;
+  const int LINES = 20000;
+  static LogRing ring(fakeMillis);
+  drain(ring);
+  uint32_t droppedBefore = ring.dropped();
+  uint32_t writtenBefore = ring.written();
+
+  std::atomic<int> producersLeft{PRODUCERS};
+  std::atomic<uint32_t> popped{0};
+  std::atomic<uint32_t> torn{0};
+  std::atomic<uint32_t> outOfOrder{0};
+  std::vector<std::vector<uint8_t>> seen(PRODUCERS, std::vector<uint8_t>(LINES, 0));
+
+  std::vector<std::thread> threads;
+  for (int c = 0; c < consumers; c++) {
+    threads.emplace_back([&, consumers]() {
+      int last[PRODUCERS];
+      for (int& n : last) n = -1;
+      LogRecord record;
+      for (;;) {
+        bool finished = producersLeft.load() == 0;
+        if (!ring.pop(record)) {
+          if (finished) return;
+          std::this_thread::yield();
+          continue;
+        }
+        int producer, line;
+        char check[16];
+        if (sscanf(record.text, "p%d line %d %15s", &producer, &line, check) != 3 || producer < 0 ||
+            producer >= PRODUCERS || line < 0 || line >= LINES || strcmp(check, "ok") != 0 ||
+            record.level != LOG_LEVEL_INFO) {
+          torn++;
+          continue;
+        }
+        // With one consumer, pops see each producer's lines in order
+        if (consumers == 1 && line <= last[producer]) outOfOrder++;
+        last[producer] = line;
+        seen[producer][line]++;
+        popped++;
+      }
+    });
+  }
+  for (int p = 0; p < PRODUCERS; p++) {
+    threads.emplace_back([&, p]() {
+      for (int line = 0; line < LINES; line++) {
+        ring.write(LOG_LEVEL_INFO, "race", "p%d line %d ok", p, line);
+        if (line % 64 == 0) std::this_thread::yield();  // Consumers catch up now and then
+      }
+      producersLeft--;
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  uint32_t written = ring.written() - writtenBefore;
+  uint32_t dropped = ring.dropped() - droppedBefore;
+  TEST_ASSERT_EQUAL_UINT32(PRODUCERS * LINES, written + dropped);
+  TEST_ASSERT_GREATER_THAN(0, written);
+  TEST_ASSERT_EQUAL_UINT32(written, popped.load());
+  TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder.load());
+  uint32_t duplicates = 0;
+  for (const std::vector<uint8_t>& lines : seen) {
+    for (uint8_t count : lines) duplicates += count > 1;
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, duplicates);
+
+  char report[96];
+  snprintf(report, sizeof(report), "%d consumer(s): %u written, %u dropped", consumers,
+           (unsigned)written, (unsigned)dropped);
+  TEST_MESSAGE(report);
+}
+
+void test_producers_race_one_consumer() {
+  race(1);
+}
+
+void test_producers_race_two_consumers() {
+  race(2);
+}
+
+static int evaluated = 0;
+
+static int sideEffect() {
+  return ++evaluated;
+}
+
+void test_levels_above_threshold_compile_out() {
+  uint32_t before = logRing.written() + logRing.dropped();
+  LOG_DEBUG(TEST, "debug %d", sideEffect());
+  LOG_INFO(TEST, "info %d", sideEffect());
+  TEST_ASSERT_EQUAL(0, evaluated);  // Arguments are not even evaluated
+  TEST_ASSERT_EQUAL_UINT32(before, logRing.written() + logRing.dropped());
+
+  LOG_WARN(TEST, "warn %d", sideEffect());
+  LOG_ERROR(TEST, "error %d", sideEffect());
+  TEST_ASSERT_EQUAL(2, evaluated);
+  LogRecord record;
+  TEST_ASSERT_TRUE(logRing.pop(record));
+  TEST_ASSERT_EQUAL_STRING("warn 1", record.text);
+  TEST_ASSERT_EQUAL_STRING("TEST", record.module);
+  TEST_ASSERT_EQUAL('W', LogRing::levelChar(record.level));
+  TEST_ASSERT_TRUE(logRing.pop(record));
+  TEST_ASSERT_EQUAL_STRING("error 2", record.text);
+  TEST_ASSERT_EQUAL('E', LogRing::levelChar(record.level));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_records_come_out_in_order);
+  RUN_TEST(test_long_lines_are_cut);
+  RUN_TEST(test_full_ring_drops_without_waiting);
+  RUN_TEST(test_producers_race_one_consumer);
+  RUN_TEST(test_producers_race_two_consumers);
+  RUN_TEST(test_levels_above_threshold_compile_out);
+  return UNITY_END();
+}
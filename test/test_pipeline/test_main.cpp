@@ -0,0 +1,197 @@
+// The task pipeline of src/main.cpp with std::thread standing in for the
+// FreeRTOS tasks: a sensor thread pushes every sample into the network
+// and UI queues, counting refusals the way the sensor task does, and a UI
+// thread publishes LCD screens through the triple buffer. Consumers check
+// ordering, tearing and that lost samples are exactly the counted ones.
+//
+//   pio test -e native -f test_pipeline
+
+#include <unity.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include "LcdFrame.h"
+#include "ScanController.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+// Same instances as the firmware's pipeline
+static SpscQueue<RadarSample, 16> networkQueue;
+static SpscQueue<RadarSample, 16> uiQueue;
+static TripleBuffer<LcdScreen> lcdMailbox;
+
+static const int SAMPLES = 50000;
+
+// Every field carries the reading number, so a torn copy shows up
+static RadarSample makeSample(int reading) {
+  RadarSample sample;
+  sample.angle = reading;
+  sample.distance = (float)(reading % 4096);
+  sample.range = (float)(reading % 4096) + 0.5f;
+  sample.detecting = reading % 2 == 1;
+  return sample;
+}
+
+static bool intact(const RadarSample& sample) {
+  int reading = sample.angle;
+  return sample.distance == (float)(reading % 4096) && sample.range == sample.distance + 0.5f &&
+         sample.detecting == (reading % 2 == 1);
+}
+
+struct ConsumerResult {
+  int received = 0;
+  int outOfOrder = 0;
+  int torn = 0;
+};
+
+// Drains a queue until the producer is done and the queue is empty,
+// starting once released; pauseEvery makes it fall behind now and then,
+// like a busy task
+static void consume(SpscQueue<RadarSample, 16>& queue, const std::atomic<bool>& producing,
+                    const std::atomic<bool>& released, int pauseEvery, ConsumerResult& result) {
+  int last = -1;
+  RadarSample sample;
+  while (!released.load()) std::this_thread::yield();
+  for (;;) {
+    bool done = !producing.load();
+    if (!queue.pop(sample)) {
+      if (done) return;
+      std::this_thread::yield();
+      continue;
+    }
+    if (!intact(sample)) result.torn++;
+    if (sample.angle <= last) result.outOfOrder++;
+    last = sample.angle;
+    result.received++;
+    if (pauseEvery > 0 && result.received % pauseEvery == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_queues_keep_order_and_count_losses() {
+  // The UI consumer is held back until its queue has overflowed, so some
+  // drops happen however the host schedules the threads
+  const int UI_HELD_FOR = 64;
+  std::atomic<bool> producing{true};
+  std::atomic<bool> networkReleased{true};
+  std::atomic<bool> uiReleased{false};
+  uint32_t networkDropped = 0;
+  uint32_t uiDropped = 0;
+  ConsumerResult network, ui;
+
+  std::thread networkTask(consume, std::ref(networkQueue), std::cref(producing),
+                          std::cref(networkReleased), 0, std::ref(network));
+  std::thread uiTask(consume, std::ref(uiQueue), std::cref(producing), std::cref(uiReleased), 256,
+                     std::ref(ui));
+  std::thread sensorTask([&]() {
+    for (int reading = 0; reading < SAMPLES; reading++) {
+      RadarSample sample = makeSample(reading);
+      if (!networkQueue.push(sample)) networkDropped++;
+      if (!uiQueue.push(sample)) uiDropped++;
+      if (reading + 1 == UI_HELD_FOR) uiReleased.store(true);
+      // A reading every few us instead of every ~60 ms: far more load than
+      // the firmware sees, but slow enough for an unhurried consumer
+      if (reading % 4 == 0) std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    producing.store(false);
+  });
+  sensorTask.join();
+  networkTask.join();
+  uiTask.join();
+
+  char report[128];
+  snprintf(report, sizeof(report), "network: %d received, %u dropped; ui: %d received, %u dropped",
+           network.received, (unsigned)networkDropped, ui.received, (unsigned)uiDropped);
+  TEST_MESSAGE(report);
+
+  TEST_ASSERT_EQUAL(0, network.torn);
+  TEST_ASSERT_EQUAL(0, network.outOfOrder);
+  TEST_ASSERT_EQUAL(SAMPLES, network.received + (int)networkDropped);
+  TEST_ASSERT_EQUAL(0, ui.torn);
+  TEST_ASSERT_EQUAL(0, ui.outOfOrder);
+  TEST_ASSERT_EQUAL(SAMPLES, ui.received + (int)uiDropped);
+  // At least everything pushed into the full queue while the UI was held
+  TEST_ASSERT_TRUE(uiDropped >= (uint32_t)(UI_HELD_FOR - 16));
+  TEST_ASSERT_TRUE(networkQueue.empty());
+  TEST_ASSERT_TRUE(uiQueue.empty());
+}
+
+// A screen whose every cell encodes the same frame number
+static void drawFrame(LcdScreen& screen, uint32_t frame) {
+  for (int row = 0; row < LcdFrame::ROWS; row++) {
+    for (int col = 0; col < LcdFrame::COLS; col++) {
+      screen.cells[row][col] = (char)((frame >> ((col % 4) * 8)) & 0xff);
+    }
+  }
+}
+
+static bool frameOf(const LcdScreen& screen, uint32_t& frame) {
+  frame = 0;
+  for (int col = 0; col < 4; col++) frame |= (uint32_t)(uint8_t)screen.cells[0][col] << (col * 8);
+  LcdScreen expected;
+  drawFrame(expected, frame);
+  return memcmp(&expected, &screen, sizeof(screen)) == 0;
+}
+
+void test_mailbox_hands_over_whole_screens() {
+  const uint32_t FRAMES = 20000;
+  std::atomic<bool> publishing{true};
+  uint32_t taken = 0, torn = 0, backwards = 0, lastFrame = 0;
+  bool any = false;
+
+  std::thread lcdTask([&]() {
+    LcdScreen screen;
+    for (;;) {
+      bool done = !publishing.load();
+      if (!lcdMailbox.take(screen)) {
+        if (done) return;
+        std::this_thread::yield();
+        continue;
+      }
+      uint32_t frame;
+      if (!frameOf(screen, frame)) torn++;
+      if (any && frame <= lastFrame) backwards++;
+      any = true;
+      lastFrame = frame;
+      taken++;
+    }
+  });
+  std::thread uiTask([&]() {
+    LcdScreen screen;
+    for (uint32_t frame = 1; frame <= FRAMES; frame++) {
+      drawFrame(screen, frame);
+      lcdMailbox.publish(screen);
+      if (frame % 16 == 0) std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    publishing.store(false);
+  });
+  uiTask.join();
+  lcdTask.join();
+
+  char report[96];
+  snprintf(report, sizeof(report), "mailbox: %u of %u screens taken", (unsigned)taken, (unsigned)FRAMES);
+  TEST_MESSAGE(report);
+
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, backwards);
+  TEST_ASSERT_GREATER_THAN(0, taken);
+  TEST_ASSERT_EQUAL_UINT32(FRAMES, lastFrame);  // The newest screen always gets through
+  LcdScreen screen;
+  TEST_ASSERT_FALSE(lcdMailbox.take(screen));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_queues_keep_order_and_count_losses);
+  RUN_TEST(test_mailbox_hands_over_whole_screens);
+  return UNITY_END();
+}
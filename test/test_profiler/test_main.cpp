@@ -0,0 +1,192 @@
+// ProfileStage histogram math: exact small values, percentile error within
+// one bucket, the ends of the 32-bit range, and the text report.
+//
+//   pio test -e native -f test_profiler
+
+#include <unity.h>
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "Profiler.h"
+
+static ProfileStage stage("test.stage");
+
+void setUp() {
+  stage.reset();
+}
+
+void tearDown() {}
+
+void test_empty_stage_reports_zeros() {
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(0, s.count);
+  TEST_ASSERT_EQUAL_UINT32(0, s.minTicks);
+  TEST_ASSERT_EQUAL_UINT32(0, s.maxTicks);
+  TEST_ASSERT_EQUAL_UINT32(0, s.p50Ticks);
+  TEST_ASSERT_EQUAL_UINT32(0, s.p99Ticks);
+}
+
+void test_small_values_are_exact() {
+  // Below SUB_BUCKETS every value has a bucket of its own
+  for (uint32_t t = 0; t < 4; t++) stage.record(t);
+  stage.record(1);
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(5, s.count);
+  TEST_ASSERT_EQUAL_UINT32(0, s.minTicks);
+  TEST_ASSERT_EQUAL_UINT32(3, s.maxTicks);
+  TEST_ASSERT_EQUAL_UINT64(7, s.totalTicks);
+  TEST_ASSERT_EQUAL_UINT32(1, s.p50Ticks);  // rank 3 of 0,1,1,2,3
+  TEST_ASSERT_EQUAL_UINT32(3, s.p99Ticks);
+}
+
+void test_single_value_is_clamped_to_itself() {
+  stage.record(1000);
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(1000, s.p50Ticks);
+  TEST_ASSERT_EQUAL_UINT32(1000, s.p99Ticks);
+}
+
+// A bucket spans a quarter of its octave, so an estimate is never further
+// than that from the true order statistic
+static void assertWithinBucket(uint32_t expected, uint32_t actual) {
+  uint32_t tolerance = expected / 4 + 1;
+  TEST_ASSERT_UINT32_WITHIN(tolerance, expected, actual);
+}
+
+void test_percentiles_of_uniform_spread() {
+  for (uint32_t t = 1; t <= 1000; t++) stage.record(t);
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(1, s.minTicks);
+  TEST_ASSERT_EQUAL_UINT32(1000, s.maxTicks);
+  TEST_ASSERT_EQUAL_UINT64(500500, s.totalTicks);
+  // A full bucket interpolates close to exact; 990 sits in one that
+  // stops at 1000 of its 896..1023
+  TEST_ASSERT_UINT32_WITHIN(4, 500, s.p50Ticks);
+  assertWithinBucket(990, s.p99Ticks);
+  TEST_ASSERT_TRUE(s.p99Ticks <= s.maxTicks);
+}
+
+void test_percentiles_against_sorted_reference() {
+  srand(7);
+  std::vector<uint32_t> samples;
+  for (int i = 0; i < 5000; i++) {
+    // Spread over several octaves, like real stage timings
+    uint32_t t = (uint32_t)(rand() % 1000 + 1) << (rand() % 12);
+    samples.push_back(t);
+    stage.record(t);
+  }
+  std::sort(samples.begin(), samples.end());
+  uint32_t n = samples.size();
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(samples.front(), s.minTicks);
+  TEST_ASSERT_EQUAL_UINT32(samples.back(), s.maxTicks);
+  assertWithinBucket(samples[(n + 1) / 2 - 1], s.p50Ticks);
+  assertWithinBucket(samples[n - n / 100 - 1], s.p99Ticks);
+}
+
+void test_p99_finds_the_tail() {
+  for (int i = 0; i < 980; i++) stage.record(100);
+  for (int i = 0; i < 20; i++) stage.record(1000000);
+  ProfileSummary s = stage.summary();
+  assertWithinBucket(100, s.p50Ticks);  // Spread across 96..111
+  assertWithinBucket(1000000, s.p99Ticks);
+}
+
+void test_octave_edges() {
+  // Each power of two starts a bucket; one below ends the previous one
+  for (int bit = 2; bit < 32; bit++) {
+    uint32_t edge = 1u << bit;
+    stage.reset();
+    stage.record(edge);
+    stage.record(edge - 1);
+    ProfileSummary s = stage.summary();
+    TEST_ASSERT_EQUAL_UINT32(edge - 1, s.p50Ticks);
+    TEST_ASSERT_EQUAL_UINT32(edge, s.p99Ticks);
+  }
+}
+
+void test_extremes_of_the_range() {
+  stage.record(UINT32_MAX);
+  stage.record(UINT32_MAX);
+  stage.record(0);
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(0, s.minTicks);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, s.maxTicks);
+  TEST_ASSERT_EQUAL_UINT64(2ull * UINT32_MAX, s.totalTicks);  // No 32-bit overflow
+  // Both land in the top bucket, 0xE0000000 up, without wrapping past 2^32
+  TEST_ASSERT_TRUE(s.p50Ticks >= 0xE0000000u);
+  TEST_ASSERT_TRUE(s.p50Ticks <= s.p99Ticks);
+}
+
+void test_reset_clears_everything() {
+  stage.record(5000);
+  ProfileStage::resetAll();
+  stage.record(7);
+  ProfileSummary s = stage.summary();
+  TEST_ASSERT_EQUAL_UINT32(1, s.count);
+  TEST_ASSERT_EQUAL_UINT32(7, s.minTicks);
+  TEST_ASSERT_EQUAL_UINT32(7, s.maxTicks);
+  TEST_ASSERT_EQUAL_UINT32(7, s.p99Ticks);
+}
+
+static const char* findLine(const char* report, const char* name) {
+  const char* line = strstr(report, name);
+  TEST_ASSERT_TRUE_MESSAGE(line != nullptr, name);
+  return line;
+}
+
+void test_report_renders_microseconds() {
+  // 1000 ticks per microsecond on the host
+  stage.record(1500);
+  stage.record(2500);
+  char report[2048];
+  size_t len = profileReport(report, sizeof(report));
+  TEST_ASSERT_EQUAL(strlen(report), len);
+
+  char name[32];
+  unsigned long count;
+  float minUs, avgUs, p50Us, p99Us, maxUs;
+  int fields = sscanf(findLine(report, "test.stage"), "%31s %lu %f %f %f %f %f", name, &count,
+                      &minUs, &avgUs, &p50Us, &p99Us, &maxUs);
+  TEST_ASSERT_EQUAL(7, fields);
+  TEST_ASSERT_EQUAL(2, count);
+  TEST_ASSERT_EQUAL_FLOAT(1.5f, minUs);
+  TEST_ASSERT_EQUAL_FLOAT(2.0f, avgUs);
+  TEST_ASSERT_EQUAL_FLOAT(2.5f, maxUs);
+}
+
+void test_report_keeps_whole_lines() {
+  char full[2048];
+  size_t fullLen = profileReport(full, sizeof(full));
+  const char* firstStage = strchr(full, '\n') + 1;
+  const char* secondStage = strchr(firstStage, '\n') + 1;
+
+  // Room for the header, one stage and half of the next
+  size_t size = (secondStage - full) + (strchr(secondStage, '\n') - secondStage) / 2;
+  char cut[2048];
+  size_t len = profileReport(cut, size);
+  TEST_ASSERT_EQUAL(secondStage - full, len);
+  TEST_ASSERT_EQUAL('\n', cut[len - 1]);
+  TEST_ASSERT_EQUAL_STRING_LEN(full, cut, len);
+  TEST_ASSERT_TRUE(len < fullLen);
+  TEST_ASSERT_EQUAL(0, profileReport(cut, 0));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_stage_reports_zeros);
+  RUN_TEST(test_small_values_are_exact);
+  RUN_TEST(test_single_value_is_clamped_to_itself);
+  RUN_TEST(test_percentiles_of_uniform_spread);
+  RUN_TEST(test_percentiles_against_sorted_reference);
+  RUN_TEST(test_p99_finds_the_tail);
+  RUN_TEST(test_octave_edges);
+  RUN_TEST(test_extremes_of_the_range);
+  RUN_TEST(test_reset_clears_everything);
+  RUN_TEST(test_report_renders_microseconds);
+  RUN_TEST(test_report_keeps_whole_lines);
+  return UNITY_END();
+}
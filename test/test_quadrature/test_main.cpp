@@ -0,0 +1,162 @@
+// QuadratureDecoder fed simulated CLK/DT sequences: both directions,
+// contact bounce, missed edges, the glitch filter and detent rounding.
+//
+//   pio test -e native -f test_quadrature
+
+#include <unity.h>
+
+#include "QuadratureDecoder.h"
+
+// Clockwise order of (clk << 1) | dt, CLK leading DT
+static const uint8_t CW[4] = {0b00, 0b10, 0b11, 0b01};
+
+static QuadratureDecoder decoder;
+static uint32_t nowUs;
+static int phase;  // Index into CW of the current levels
+
+void setUp() {
+  decoder = QuadratureDecoder();
+  decoder.reset(false, false);
+  nowUs = 0;
+  phase = 0;
+}
+
+void tearDown() {}
+
+static int feedLevels(uint8_t levels) {
+  nowUs += 100;
+  return decoder.feed(levels & 0b10, levels & 0b01, nowUs);
+}
+
+// One edge clockwise (+1) or counterclockwise (-1)
+static int turn(int direction) {
+  phase = (phase + direction + 4) % 4;
+  return feedLevels(CW[phase]);
+}
+
+static void clicks(int detents) {
+  int direction = detents > 0 ? 1 : -1;
+  for (int i = 0; i < detents * direction * QuadratureDecoder::COUNTS_PER_DETENT; i++) turn(direction);
+}
+
+void test_clockwise_counts_up() {
+  for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL(1, turn(1));
+  TEST_ASSERT_EQUAL(4, decoder.count());
+  TEST_ASSERT_EQUAL(1, decoder.detents());
+  TEST_ASSERT_EQUAL_UINT32(0, decoder.invalidTransitions());
+}
+
+void test_counterclockwise_counts_down() {
+  for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL(-1, turn(-1));
+  TEST_ASSERT_EQUAL(-4, decoder.count());
+  TEST_ASSERT_EQUAL(-1, decoder.detents());
+}
+
+void test_negative_counts_and_back() {
+  clicks(-5);
+  TEST_ASSERT_EQUAL(-20, decoder.count());
+  TEST_ASSERT_EQUAL(-5, decoder.detents());
+  clicks(7);
+  TEST_ASSERT_EQUAL(8, decoder.count());
+  TEST_ASSERT_EQUAL(2, decoder.detents());
+}
+
+void test_bounce_cancels() {
+  // One line chattering at a rest position: +1/-1 pairs
+  for (int i = 0; i < 10; i++) {
+    turn(1);
+    turn(-1);
+  }
+  TEST_ASSERT_EQUAL(0, decoder.count());
+  TEST_ASSERT_EQUAL(0, decoder.detents());
+  TEST_ASSERT_EQUAL_UINT32(0, decoder.invalidTransitions());
+}
+
+void test_nudge_off_rest_is_not_a_detent() {
+  // Boundaries sit halfway between clicks, so a count either way is noise
+  turn(-1);
+  TEST_ASSERT_EQUAL(-1, decoder.count());
+  TEST_ASSERT_EQUAL(0, decoder.detents());
+  turn(1);
+  turn(1);
+  TEST_ASSERT_EQUAL(1, decoder.count());
+  TEST_ASSERT_EQUAL(0, decoder.detents());
+
+  // Same off a non-zero rest position
+  turn(-1);
+  clicks(-3);
+  TEST_ASSERT_EQUAL(-3, decoder.detents());
+  turn(1);
+  TEST_ASSERT_EQUAL(-3, decoder.detents());
+  turn(-1);
+  turn(-1);
+  TEST_ASSERT_EQUAL(-3, decoder.detents());
+}
+
+void test_invalid_double_transition_resyncs() {
+  // Both lines change between samples: direction unknown, nothing counted
+  TEST_ASSERT_EQUAL(0, feedLevels(0b11));
+  TEST_ASSERT_EQUAL_UINT32(1, decoder.invalidTransitions());
+  TEST_ASSERT_EQUAL(0, decoder.count());
+
+  // Decoding carries on from the new state
+  phase = 2;
+  TEST_ASSERT_EQUAL(1, turn(1));
+  TEST_ASSERT_EQUAL(-1, turn(-1));
+  TEST_ASSERT_EQUAL(-1, turn(-1));
+  TEST_ASSERT_EQUAL(-1, decoder.count());
+  TEST_ASSERT_EQUAL_UINT32(1, decoder.invalidTransitions());
+}
+
+void test_glitch_filter_drops_short_pulses() {
+  decoder = QuadratureDecoder(20);
+  decoder.reset(false, false);
+
+  // 10us spike on CLK
+  TEST_ASSERT_EQUAL(0, decoder.feed(true, false, 1000));
+  TEST_ASSERT_EQUAL(0, decoder.feed(true, false, 1010));
+  TEST_ASSERT_EQUAL(0, decoder.feed(false, false, 1010));
+  TEST_ASSERT_EQUAL(0, decoder.feed(false, false, 1100));
+  TEST_ASSERT_EQUAL(0, decoder.count());
+
+  // Held past the filter, it counts once
+  TEST_ASSERT_EQUAL(0, decoder.feed(true, false, 2000));
+  TEST_ASSERT_EQUAL(0, decoder.feed(true, false, 2019));
+  TEST_ASSERT_EQUAL(1, decoder.feed(true, false, 2020));
+  TEST_ASSERT_EQUAL(0, decoder.feed(true, false, 2100));
+  TEST_ASSERT_EQUAL(1, decoder.count());
+}
+
+void test_count_passes_16_bit_range() {
+  // The hardware counter is cleared on every read; the running count is
+  // 32-bit and must carry on past where an int16 would wrap
+  clicks(8200);
+  TEST_ASSERT_EQUAL(32800, decoder.count());
+  TEST_ASSERT_EQUAL(8200, decoder.detents());
+  clicks(-16400);
+  TEST_ASSERT_EQUAL(-32800, decoder.count());
+  TEST_ASSERT_EQUAL(-8200, decoder.detents());
+}
+
+void test_counts_to_detents_rounding() {
+  const int per = QuadratureDecoder::COUNTS_PER_DETENT;
+  for (int detent = -3; detent <= 3; detent++) {
+    TEST_ASSERT_EQUAL(detent, QuadratureDecoder::countsToDetents(detent * per - 1));
+    TEST_ASSERT_EQUAL(detent, QuadratureDecoder::countsToDetents(detent * per));
+    TEST_ASSERT_EQUAL(detent, QuadratureDecoder::countsToDetents(detent * per + 1));
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clockwise_counts_up);
+  RUN_TEST(test_counterclockwise_counts_down);
+  RUN_TEST(test_negative_counts_and_back);
+  RUN_TEST(test_bounce_cancels);
+  RUN_TEST(test_nudge_off_rest_is_not_a_detent);
+  RUN_TEST(test_invalid_double_transition_resyncs);
+  RUN_TEST(test_glitch_filter_drops_short_pulses);
+  RUN_TEST(test_count_passes_16_bit_range);
+  RUN_TEST(test_counts_to_detents_rounding);
+  return UNITY_END();
+}
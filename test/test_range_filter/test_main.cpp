@@ -0,0 +1,156 @@
+// RangeFilter: the three combining modes, early exit, the ping cap and
+// readings where every ping timed out.
+//
+//   pio test -e native -f test_range_filter
+
+#include <unity.h>
+
+#include "RadarConfig.h"
+#include "RangeFilter.h"
+
+static RangeFilterConfig withMode(FilterMode mode) {
+  RangeFilterConfig config = RANGE_FILTER;
+  config.mode = mode;
+  return config;
+}
+
+// Adds every ping regardless of done(), the way a fixed-count reading would
+static float combine(FilterMode mode, const float* pings, int count) {
+  RangeFilterConfig config = withMode(mode);
+  config.minPings = RangeFilter::MAX_PINGS;
+  config.maxPings = RangeFilter::MAX_PINGS;
+  RangeFilter filter(config);
+  for (int i = 0; i < count; i++) filter.add(pings[i]);
+  return filter.result();
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_median_of_odd_and_even_counts() {
+  const float odd[] = {120, 80, 100, 300, 90};
+  TEST_ASSERT_EQUAL_FLOAT(100, combine(FILTER_MEDIAN, odd, 5));
+  const float even[] = {120, 80, 100, 90};
+  TEST_ASSERT_EQUAL_FLOAT(95, combine(FILTER_MEDIAN, even, 4));
+  const float single[] = {42};
+  TEST_ASSERT_EQUAL_FLOAT(42, combine(FILTER_MEDIAN, single, 1));
+}
+
+void test_trimmed_mean_drops_both_ends() {
+  // 0.2 of five pings trims one from each end
+  const float pings[] = {10, 100, 102, 104, 390};
+  TEST_ASSERT_EQUAL_FLOAT(102, combine(FILTER_TRIMMED_MEAN, pings, 5));
+  // Three pings still lose their extremes even though 0.2 * 3 rounds to 0
+  const float three[] = {50, 60, 400};
+  TEST_ASSERT_EQUAL_FLOAT(60, combine(FILTER_TRIMMED_MEAN, three, 3));
+  // Two pings are just averaged
+  const float two[] = {50, 60};
+  TEST_ASSERT_EQUAL_FLOAT(55, combine(FILTER_TRIMMED_MEAN, two, 2));
+}
+
+void test_hampel_rejects_outliers() {
+  const float pings[] = {100, 101, 99, 100, 250};
+  TEST_ASSERT_EQUAL_FLOAT(100, combine(FILTER_HAMPEL, pings, 5));
+  // A zero MAD falls back to the tolerance window instead of rejecting all
+  const float same[] = {80, 80, 80, 81};
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 80.25f, combine(FILTER_HAMPEL, same, 4));
+}
+
+void test_agreeing_pings_end_the_reading_early() {
+  const FilterMode modes[] = {FILTER_MEDIAN, FILTER_TRIMMED_MEAN, FILTER_HAMPEL};
+  for (FilterMode mode : modes) {
+    RangeFilter filter(withMode(mode));
+    TEST_ASSERT_FALSE(filter.add(150.0f));
+    TEST_ASSERT_TRUE(filter.add(151.5f));  // Within 2cm
+    TEST_ASSERT_EQUAL(2, filter.count());
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 150.75f, filter.result());
+  }
+}
+
+void test_relative_tolerance_for_far_targets() {
+  // 2% of 300cm is 6cm, wider than the absolute 2cm
+  RangeFilter filter(RANGE_FILTER);
+  filter.add(300.0f);
+  TEST_ASSERT_TRUE(filter.add(305.0f));
+}
+
+void test_disagreement_pulls_in_pings_until_a_majority() {
+  RangeFilter filter(RANGE_FILTER);
+  TEST_ASSERT_FALSE(filter.add(100.0f));
+  TEST_ASSERT_FALSE(filter.add(40.0f));   // Ghost
+  TEST_ASSERT_TRUE(filter.add(101.0f));   // Two of three agree
+  TEST_ASSERT_EQUAL(3, filter.count());
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, filter.result());
+}
+
+void test_configured_cap_stops_a_noisy_reading() {
+  RangeFilter filter(RANGE_FILTER);
+  const float scattered[] = {50, 120, 200, 280, 360, 30, 90};
+  int added = 0;
+  while (!filter.add(scattered[added])) added++;
+  TEST_ASSERT_EQUAL(RANGE_FILTER.maxPings - 1, added);
+  TEST_ASSERT_EQUAL(RANGE_FILTER.maxPings, filter.count());
+  TEST_ASSERT_EQUAL_FLOAT(200, filter.result());
+
+  // Extra pings after the cap are ignored
+  TEST_ASSERT_TRUE(filter.add(scattered[5]));
+  TEST_ASSERT_EQUAL(RANGE_FILTER.maxPings, filter.count());
+}
+
+void test_config_is_clamped_to_max_pings() {
+  RangeFilterConfig config = RANGE_FILTER;
+  config.minPings = 0;
+  config.maxPings = RangeFilter::MAX_PINGS + 5;
+  RangeFilter filter(config);
+  TEST_ASSERT_EQUAL(1, filter.config().minPings);
+  TEST_ASSERT_EQUAL(RangeFilter::MAX_PINGS, filter.config().maxPings);
+
+  for (int i = 0; i < RangeFilter::MAX_PINGS - 1; i++) TEST_ASSERT_FALSE(filter.add(20.0f + i * 40));
+  TEST_ASSERT_TRUE(filter.add(390.0f));
+  TEST_ASSERT_EQUAL(RangeFilter::MAX_PINGS, filter.count());
+
+  config.minPings = 7;
+  config.maxPings = 3;
+  RangeFilter inverted(config);
+  TEST_ASSERT_EQUAL(3, inverted.config().minPings);
+}
+
+void test_all_timeouts_read_as_max_range() {
+  // ScanController feeds a timed-out ping as the full range, so missing
+  // echoes agree with each other and end the reading at the minimum
+  const FilterMode modes[] = {FILTER_MEDIAN, FILTER_TRIMMED_MEAN, FILTER_HAMPEL};
+  for (FilterMode mode : modes) {
+    RangeFilter filter(withMode(mode));
+    TEST_ASSERT_FALSE(filter.add(MAX_DETECTION_LIMIT));
+    TEST_ASSERT_TRUE(filter.add(MAX_DETECTION_LIMIT));
+    TEST_ASSERT_EQUAL(RANGE_FILTER.minPings, filter.count());
+    TEST_ASSERT_EQUAL_FLOAT(MAX_DETECTION_LIMIT, filter.result());
+  }
+}
+
+void test_reset_and_empty_result() {
+  RangeFilter filter(RANGE_FILTER);
+  TEST_ASSERT_EQUAL_FLOAT(0, filter.result());
+  filter.add(100.0f);
+  filter.add(100.0f);
+  TEST_ASSERT_TRUE(filter.done());
+  filter.reset();
+  TEST_ASSERT_FALSE(filter.done());
+  TEST_ASSERT_EQUAL(0, filter.count());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_median_of_odd_and_even_counts);
+  RUN_TEST(test_trimmed_mean_drops_both_ends);
+  RUN_TEST(test_hampel_rejects_outliers);
+  RUN_TEST(test_agreeing_pings_end_the_reading_early);
+  RUN_TEST(test_relative_tolerance_for_far_targets);
+  RUN_TEST(test_disagreement_pulls_in_pings_until_a_majority);
+  RUN_TEST(test_configured_cap_stops_a_noisy_reading);
+  RUN_TEST(test_config_is_clamped_to_max_pings);
+  RUN_TEST(test_all_timeouts_read_as_max_range);
+  RUN_TEST(test_reset_and_empty_result);
+  return UNITY_END();
+}
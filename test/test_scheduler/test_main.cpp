@@ -0,0 +1,235 @@
+// Timer wheel behaviour on a virtual clock: periods, far jobs, cancel and
+// re-arm, millis() wraparound and clock jumps.
+//
+//   pio test -e native -f test_scheduler
+
+#include <unity.h>
+
+#include "Scheduler.h"
+#include "VirtualClock.h"
+
+// Records when it ran and asks to run again after period (or never)
+class RecordingJob : public SchedJob {
+public:
+  explicit RecordingJob(uint32_t periodMs = SCHED_IDLE) : periodMs(periodMs) {}
+  uint32_t run(uint32_t nowMs) override {
+    if (runs < MAX_RUNS) at[runs] = nowMs;
+    runs++;
+    return periodMs;
+  }
+
+  static const int MAX_RUNS = 256;
+  uint32_t periodMs;
+  uint32_t at[MAX_RUNS] = {};
+  int runs = 0;
+};
+
+static VirtualClock testClock;
+
+// Sleeps the way the UI task does: run, then advance by the returned wait
+static void runUntil(Scheduler& scheduler, uint32_t endMs) {
+  uint32_t startMs = testClock.millis();
+  while (testClock.millis() - startMs <= endMs - startMs) {
+    uint32_t waitMs = scheduler.run(testClock.millis());
+    if (waitMs == SCHED_IDLE) return;
+    testClock.advanceMs(waitMs);
+  }
+}
+
+void setUp() {
+  testClock = VirtualClock();
+}
+
+void tearDown() {}
+
+void test_periodic_jobs_keep_their_periods() {
+  Scheduler scheduler(testClock.millis());
+  RecordingJob fast(10), odd(7), slow(150);  // slow spans two revolutions
+  scheduler.schedule(fast, 0);
+  scheduler.schedule(odd, 0, 3);
+  scheduler.schedule(slow, 0, 100);
+
+  runUntil(scheduler, 1000);
+
+  TEST_ASSERT_EQUAL(101, fast.runs);
+  for (int i = 0; i < fast.runs; i++) TEST_ASSERT_EQUAL_UINT32(i * 10, fast.at[i]);
+  TEST_ASSERT_EQUAL(143, odd.runs);
+  for (int i = 0; i < odd.runs; i++) TEST_ASSERT_EQUAL_UINT32(3 + i * 7, odd.at[i]);
+  TEST_ASSERT_EQUAL(7, slow.runs);
+  for (int i = 0; i < slow.runs; i++) TEST_ASSERT_EQUAL_UINT32(100 + i * 150, slow.at[i]);
+}
+
+void test_job_beyond_one_revolution_waits_its_turn() {
+  Scheduler scheduler(testClock.millis());
+  // Same slot as 1000 % SLOTS, but revolutions apart
+  RecordingJob far, near;
+  scheduler.schedule(far, 0, 1000);
+  scheduler.schedule(near, 0, 1000 % Scheduler::SLOTS);
+
+  TEST_ASSERT_EQUAL_UINT32(1000 % Scheduler::SLOTS, scheduler.untilNext(0));
+  runUntil(scheduler, 999);
+  TEST_ASSERT_EQUAL(1, near.runs);
+  TEST_ASSERT_EQUAL(0, far.runs);
+  TEST_ASSERT_TRUE(far.pending());
+  TEST_ASSERT_EQUAL_UINT32(1000 - testClock.millis(), scheduler.untilNext(testClock.millis()));
+
+  runUntil(scheduler, 2000);
+  TEST_ASSERT_EQUAL(1, far.runs);
+  TEST_ASSERT_EQUAL_UINT32(1000, far.at[0]);
+}
+
+void test_millis_wraparound() {
+  testClock.advanceMs(0xFFFFFFC0);  // 64 ms before millis() wraps
+  Scheduler scheduler(testClock.millis());
+  RecordingJob periodic(40), far;
+  scheduler.schedule(periodic, testClock.millis());
+  scheduler.schedule(far, testClock.millis(), 200);  // Due after the wrap
+
+  runUntil(scheduler, 0x00000400);
+
+  TEST_ASSERT_EQUAL(28, periodic.runs);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFC0, periodic.at[0]);
+  for (int i = 1; i < periodic.runs; i++) TEST_ASSERT_EQUAL_UINT32(40, periodic.at[i] - periodic.at[i - 1]);
+  TEST_ASSERT_EQUAL(1, far.runs);
+  TEST_ASSERT_EQUAL_UINT32(0x00000088, far.at[0]);
+}
+
+void test_cancel_and_rearm() {
+  Scheduler scheduler(testClock.millis());
+  RecordingJob job;
+  scheduler.schedule(job, 0, 30);
+  scheduler.cancel(job);
+  TEST_ASSERT_FALSE(job.pending());
+  TEST_ASSERT_EQUAL_UINT32(SCHED_IDLE, scheduler.run(100));
+  TEST_ASSERT_EQUAL(0, job.runs);
+
+  // Re-arming moves the job rather than adding a second copy
+  scheduler.schedule(job, 100, 500);
+  scheduler.schedule(job, 100, 20);
+  TEST_ASSERT_EQUAL_UINT32(20, scheduler.untilNext(100));
+  TEST_ASSERT_EQUAL_UINT32(SCHED_IDLE, scheduler.run(120));
+  TEST_ASSERT_EQUAL(1, job.runs);
+  TEST_ASSERT_EQUAL_UINT32(120, job.at[0]);
+  TEST_ASSERT_FALSE(job.pending());
+
+  // Cancelling one job of a shared slot leaves the other
+  RecordingJob a, b;
+  scheduler.schedule(a, 200, Scheduler::SLOTS);
+  scheduler.schedule(b, 200, 2 * Scheduler::SLOTS);
+  scheduler.cancel(a);
+  scheduler.run(200 + 2 * Scheduler::SLOTS);
+  TEST_ASSERT_EQUAL(0, a.runs);
+  TEST_ASSERT_EQUAL(1, b.runs);
+}
+
+// A job that re-arms or cancels another from inside run()
+class ControlJob : public SchedJob {
+public:
+  ControlJob(Scheduler& scheduler, SchedJob& other, bool rearm)
+      : scheduler_(scheduler), other_(other), rearm_(rearm) {}
+  uint32_t run(uint32_t nowMs) override {
+    if (rearm_) scheduler_.schedule(other_, nowMs, 5);
+    else scheduler_.cancel(other_);
+    return SCHED_IDLE;
+  }
+
+private:
+  Scheduler& scheduler_;
+  SchedJob& other_;
+  bool rearm_;
+};
+
+void test_cancel_and_rearm_from_a_job() {
+  Scheduler scheduler(testClock.millis());
+  RecordingJob victim(10), target;
+  ControlJob canceller(scheduler, victim, false);
+  ControlJob rearmer(scheduler, target, true);
+  scheduler.schedule(victim, 0, 5);
+  scheduler.schedule(target, 0, 50);
+  scheduler.schedule(canceller, 0, 12);
+  scheduler.schedule(rearmer, 0, 12);
+
+  runUntil(scheduler, 12);
+  TEST_ASSERT_EQUAL(1, victim.runs);
+  TEST_ASSERT_FALSE(victim.pending());
+  TEST_ASSERT_TRUE(target.pending());
+  TEST_ASSERT_EQUAL_UINT32(5, scheduler.untilNext(12));
+
+  runUntil(scheduler, 100);
+  TEST_ASSERT_EQUAL(1, victim.runs);
+  TEST_ASSERT_EQUAL(1, target.runs);
+  TEST_ASSERT_EQUAL_UINT32(17, target.at[0]);
+}
+
+void test_zero_delay_waits_for_next_run() {
+  Scheduler scheduler(testClock.millis());
+  RecordingJob busy(0);
+  scheduler.schedule(busy, 0);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.run(0));
+  TEST_ASSERT_EQUAL(1, busy.runs);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.run(0));
+  TEST_ASSERT_EQUAL(2, busy.runs);
+}
+
+void test_large_clock_jump() {
+  Scheduler scheduler(testClock.millis());
+  RecordingJob periodic(5), far, late;
+  scheduler.schedule(periodic, 0, 20);
+  scheduler.schedule(far, 0, 5000);
+  scheduler.schedule(late, 0, 100000);
+  TEST_ASSERT_EQUAL_UINT32(20, scheduler.run(0));
+
+  // Many revolutions pass at once: overdue jobs run once, late, and the
+  // periodic one resumes from the time it actually ran
+  testClock.advanceMs(60000);
+  TEST_ASSERT_EQUAL_UINT32(5, scheduler.run(testClock.millis()));
+  TEST_ASSERT_EQUAL(1, periodic.runs);
+  TEST_ASSERT_EQUAL_UINT32(60000, periodic.at[0]);
+  TEST_ASSERT_EQUAL(1, far.runs);
+  TEST_ASSERT_EQUAL_UINT32(60000, far.at[0]);
+  TEST_ASSERT_EQUAL(0, late.runs);
+
+  runUntil(scheduler, 60100);
+  TEST_ASSERT_EQUAL(21, periodic.runs);
+  TEST_ASSERT_EQUAL_UINT32(60100, periodic.at[20]);
+  scheduler.cancel(periodic);
+  TEST_ASSERT_EQUAL_UINT32(100000 - testClock.millis(), scheduler.untilNext(testClock.millis()));
+}
+
+void test_many_jobs_fire_on_time() {
+  const int JOBS = 200;
+  static RecordingJob jobs[JOBS];
+  uint32_t dueMs[JOBS];
+  Scheduler scheduler(testClock.millis());
+  uint32_t seed = 1;
+  for (int i = 0; i < JOBS; i++) {
+    jobs[i] = RecordingJob();
+    seed = seed * 1103515245 + 12345;
+    dueMs[i] = (seed >> 8) % 5000;
+    scheduler.schedule(jobs[i], 0, dueMs[i]);
+  }
+  for (int i = 0; i < JOBS; i += 7) scheduler.cancel(jobs[i]);
+
+  runUntil(scheduler, 6000);
+  for (int i = 0; i < JOBS; i++) {
+    if (i % 7 == 0) {
+      TEST_ASSERT_EQUAL(0, jobs[i].runs);
+    } else {
+      TEST_ASSERT_EQUAL(1, jobs[i].runs);
+      TEST_ASSERT_EQUAL_UINT32(dueMs[i], jobs[i].at[0]);
+    }
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_periodic_jobs_keep_their_periods);
+  RUN_TEST(test_job_beyond_one_revolution_waits_its_turn);
+  RUN_TEST(test_millis_wraparound);
+  RUN_TEST(test_cancel_and_rearm);
+  RUN_TEST(test_cancel_and_rearm_from_a_job);
+  RUN_TEST(test_zero_delay_waits_for_next_run);
+  RUN_TEST(test_large_clock_jump);
+  RUN_TEST(test_many_jobs_fire_on_time);
+  return UNITY_END();
+}
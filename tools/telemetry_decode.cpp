@@ -0,0 +1,63 @@
+// Host decoder for the binary telemetry stream (lib/Telemetry).
+//
+// Reads a raw serial capture on stdin and writes one CSV row per sample
+// to stdout, with a fixed header. Log frames go to stderr as text,
+// followed by a frame/loss summary.
+//
+//   seq,reading,time_ms,angle_deg,distance_cm,range_cm,detecting,pings,echo_us
+//
+// Every column is a plain number except echo_us: the raw echo width of
+// each of the `pings` pings, ';'-separated in one field, empty for a ping
+// that timed out (e.g. "1712;;1698"). This is the ScanTrace layout, so a
+// capture can be replayed on the host with --replay. For pandas, split it
+// with df.echo_us.str.split(';', expand=True).
+//
+//   g++ -std=c++17 -O2 -I../lib/Telemetry telemetry_decode.cpp ../lib/Telemetry/Telemetry.cpp -o telemetry_decode
+//   stty -F /dev/ttyUSB0 115200 raw && ./telemetry_decode < /dev/ttyUSB0 > scan.csv
+//
+// Send 'b' to the device to switch it to binary output, 't' to go back.
+
+#include <stdio.h>
+
+#include "Telemetry.h"
+
+int main() {
+  TelemetryDecoder decoder;
+  uint32_t samples = 0;
+  uint32_t lostReadings = 0;
+  bool haveReading = false;
+  uint32_t lastReading = 0;
+
+  printf("seq,reading,time_ms,angle_deg,distance_cm,range_cm,detecting,pings,echo_us\n");
+
+  int c;
+  while ((c = getchar()) != EOF) {
+    if (!decoder.feed((uint8_t)c)) continue;
+
+    TelemetrySample sample;
+    TelemetryLog log;
+    if (decoder.sample(sample)) {
+      if (haveReading) lostReadings += sample.reading - lastReading - 1;
+      haveReading = true;
+      lastReading = sample.reading;
+      samples++;
+
+      printf("%u,%u,%u,%u,%u.%u,%u.%u,%d,%u,", decoder.sequence(), sample.reading,
+             sample.timeMs, sample.angle, sample.distanceMm / 10, sample.distanceMm % 10,
+             sample.rangeMm / 10, sample.rangeMm % 10, sample.detecting ? 1 : 0, sample.pings);
+      // Raw echoes in one column, ';'-separated; empty for a timed-out ping
+      for (uint8_t i = 0; i < sample.pings; i++) {
+        if (i > 0) putchar(';');
+        if (sample.echoUs[i] != TELEMETRY_NO_ECHO) printf("%u", sample.echoUs[i]);
+      }
+      putchar('\n');
+    } else if (decoder.log(log)) {
+      fprintf(stderr, "%u %.*s: %.*s\n", log.timeMs, log.moduleLen, log.module,
+              (int)log.textLen, log.text);
+    }
+  }
+
+  fprintf(stderr, "%u frames, %u samples, %u corrupt frames, %u frames lost, %u readings lost\n",
+          decoder.frames(), samples, decoder.badFrames(), decoder.lostFrames(), lostReadings);
+  return 0;
+}
@@ -0,0 +1,123 @@
+// Host converter for stage trace dumps (lib/Profiler/Trace.h).
+//
+// Reads a dump on stdin and writes Chrome trace JSON to stdout, for
+// chrome://tracing or https://ui.perfetto.dev. Each task gets a row,
+// named by the stage prefix ("net.http" -> "net"); every event carries the
+// core it ran on. Ends whose begin fell out of the ring are dropped.
+//
+//   g++ -std=c++17 -O2 -I../lib/Profiler trace_to_chrome.cpp -o trace_to_chrome
+//   curl -s http://<device>/trace | ./trace_to_chrome > radar.json
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+
+static uint32_t get16(const uint8_t* p) {
+  return p[0] | p[1] << 8;
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int main() {
+  std::vector<uint8_t> dump;
+  int c;
+  while ((c = getchar()) != EOF) dump.push_back((uint8_t)c);
+
+  if (dump.size() < TRACE_HEADER_SIZE || memcmp(dump.data(), TRACE_MAGIC, 4) != 0) {
+    fprintf(stderr, "Not a trace dump\n");
+    return 1;
+  }
+  if (get16(&dump[4]) != TRACE_VERSION) {
+    fprintf(stderr, "Unsupported trace version %u\n", get16(&dump[4]));
+    return 1;
+  }
+  uint32_t stageCount = get16(&dump[6]);
+  uint32_t eventCount = get32(&dump[8]);
+
+  // Stage names, and one row per distinct prefix
+  std::vector<std::string> names;
+  std::vector<std::string> tracks;
+  std::vector<int> stageTrack;
+  size_t at = TRACE_HEADER_SIZE;
+  for (uint32_t i = 0; i < stageCount; i++) {
+    if (at >= dump.size() || at + 1 + dump[at] > dump.size()) {
+      fprintf(stderr, "Truncated stage table\n");
+      return 1;
+    }
+    std::string name((const char*)&dump[at + 1], dump[at]);
+    at += 1 + dump[at];
+    std::string track = name.substr(0, name.find('.'));
+    int index = 0;
+    while (index < (int)tracks.size() && tracks[index] != track) index++;
+    if (index == (int)tracks.size()) tracks.push_back(track);
+    names.push_back(name);
+    stageTrack.push_back(index);
+  }
+  if (dump.size() - at < (size_t)eventCount * TRACE_EVENT_SIZE) {
+    fprintf(stderr, "Truncated event list\n");
+    return 1;
+  }
+
+  printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (size_t i = 0; i < tracks.size(); i++) {
+    printf("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+           i ? ",\n" : "", i + 1, tracks[i].c_str());
+  }
+
+  // Timestamps are 32-bit us. Unwrap each against the previous one: only a
+  // jump of more than 2^31 us is a wrap, so the small backward steps left
+  // by preempted writers stay small
+  struct Event {
+    uint64_t timeUs;
+    uint32_t stage;
+    char phase;
+    uint32_t core;
+  };
+  const uint64_t epoch = 1ull << 32;  // Room to step back from the first event
+  std::vector<Event> events;
+  uint64_t unwrapped = 0;
+  for (uint32_t i = 0; i < eventCount; i++, at += TRACE_EVENT_SIZE) {
+    uint32_t timeUs = get32(&dump[at]);
+    unwrapped = i == 0 ? epoch + timeUs : unwrapped + (int32_t)(timeUs - (uint32_t)unwrapped);
+    events.push_back({unwrapped, get16(&dump[at + 4]), (char)dump[at + 6], dump[at + 7]});
+  }
+  // Ring order is claim order; put them back in time order, keeping ring
+  // order for ties so a begin stays ahead of its end
+  std::stable_sort(events.begin(), events.end(),
+                   [](const Event& a, const Event& b) { return a.timeUs < b.timeUs; });
+
+  std::vector<int> depth(tracks.size(), 0);
+  uint32_t written = 0;
+  uint32_t skipped = 0;
+  for (const Event& event : events) {
+    if (event.stage >= names.size() || (event.phase != TRACE_BEGIN && event.phase != TRACE_END)) {
+      skipped++;
+      continue;
+    }
+    int track = stageTrack[event.stage];
+    if (event.phase == TRACE_END) {
+      if (depth[track] == 0) {
+        skipped++;
+        continue;
+      }
+      depth[track]--;
+    } else {
+      depth[track]++;
+    }
+    printf("%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%d,\"args\":{\"core\":%u}}",
+           written || !tracks.empty() ? ",\n" : "", names[event.stage].c_str(), event.phase,
+           (long long)(event.timeUs - epoch), track + 1, event.core);
+    written++;
+  }
+  printf("\n]}\n");
+
+  fprintf(stderr, "%u stages, %u events, %u skipped\n", stageCount, written, skipped);
+  return 0;
+}